@@ -0,0 +1,59 @@
+#pragma once
+#include "common.hpp"
+MUU_DISABLE_WARNINGS;
+#include <cmath>
+MUU_ENABLE_WARNINGS;
+
+namespace rt
+{
+	struct adaptive_sampling
+	{
+		// a pixel stops receiving samples once the 95% confidence interval of its mean luminance is within
+		// this fraction of the mean. zero disables adaptive sampling.
+		float threshold = 0.0f;
+
+		// samples every pixel gets before its variance estimate is trusted
+		unsigned min_samples = 16;
+
+		// the per-pixel sample limit
+		unsigned max_samples = 0;
+
+		MUU_PURE_INLINE_GETTER
+		explicit operator bool() const noexcept
+		{
+			return threshold > 0.0f;
+		}
+	};
+
+	// running mean and variance of a pixel's luminance, using welford's algorithm
+	struct pixel_variance
+	{
+		unsigned count = 0;
+		float mean	   = 0.0f;
+		float m2	   = 0.0f;
+
+		MUU_ALWAYS_INLINE
+		void MUU_VECTORCALL add(const vec3& radiance) noexcept
+		{
+			const auto x = 0.2126f * radiance.x + 0.7152f * radiance.y + 0.0722f * radiance.z;
+
+			count++;
+			const auto delta = x - mean;
+			mean += delta / static_cast<float>(count);
+			m2 += delta * (x - mean);
+		}
+
+		MUU_PURE_GETTER
+		bool converged(const adaptive_sampling& settings) const noexcept
+		{
+			if (!settings || count < muu::max(settings.min_samples, 2u))
+				return false;
+
+			const auto variance = m2 / static_cast<float>(count - 1u);
+			const auto error	= 1.96f * std::sqrt(variance / static_cast<float>(count));
+
+			// the floor stops near-black pixels from demanding an impossibly small absolute error
+			return error <= settings.threshold * muu::max(mean, 0.01f);
+		}
+	};
+}
@@ -3,12 +3,14 @@ MUU_DISABLE_WARNINGS;
 #include <SDL.h>
 #include <stdexcept>
 #include <cstring> // memcpy
+#include <cstddef>
+#include <cstdint>
 MUU_ENABLE_WARNINGS;
 
 using namespace rt;
 
 back_buffer::back_buffer(vec2u sz, void* target) //
-	: img_{ sz }
+	: size_{ sz }
 {
 	handle_ = SDL_CreateTexture(static_cast<SDL_Renderer*>(target),
 								SDL_PIXELFORMAT_RGBA8888,
@@ -21,13 +23,23 @@ back_buffer::back_buffer(vec2u sz, void* target) //
 
 back_buffer::back_buffer(back_buffer&& other) noexcept
 	: img_{ std::move(other.img_) },
-	  handle_{ std::exchange(other.handle_, {}) }
-{}
+	  handle_{ std::exchange(other.handle_, {}) },
+	  size_{ std::exchange(other.size_, {}) }
+{
+	assert(!other.locked_);
+}
 
 back_buffer& back_buffer::operator=(back_buffer&& rhs) noexcept
 {
+	assert(!locked_);
+	assert(!rhs.locked_);
+
+	if (handle_)
+		SDL_DestroyTexture(static_cast<SDL_Texture*>(handle_));
+
 	img_	= std::move(rhs.img_);
 	handle_ = std::exchange(rhs.handle_, {});
+	size_	= std::exchange(rhs.size_, {});
 	return *this;
 }
 
@@ -37,14 +49,48 @@ back_buffer::~back_buffer() noexcept
 		SDL_DestroyTexture(static_cast<SDL_Texture*>(handle_));
 }
 
-void back_buffer::flush()
+image_view back_buffer::lock()
 {
+	assert(!locked_);
+
 	void* pixels{};
 	int pitch{};
 	if (SDL_LockTexture(static_cast<SDL_Texture*>(handle_), nullptr, &pixels, &pitch) < 0)
 		throw std::runtime_error{ SDL_GetError() };
-	const auto unlock = muu::scope_guard{ [&]() noexcept { SDL_UnlockTexture(static_cast<SDL_Texture*>(handle_)); } };
+	locked_ = true;
+
+	constexpr auto pixel_size = sizeof(image::pixel_type);
+	const auto row_pixels	  = static_cast<size_t>(pitch) / pixel_size;
+	const auto direct		  = pitch > 0 && static_cast<size_t>(pitch) % pixel_size == 0u && row_pixels >= size_.x
+					   && reinterpret_cast<std::uintptr_t>(pixels) % alignof(image::pixel_type) == 0u;
+	if (direct)
+	{
+		locked_pixels_ = {};
+		return image_view{ static_cast<image::pixel_type*>(pixels), size_, static_cast<unsigned>(row_pixels) };
+	}
+
+	locked_pixels_ = pixels;
+	locked_pitch_  = pitch;
+	if (!img_)
+		img_ = image{ size_ };
+	return image_view{ img_ };
+}
+
+void back_buffer::unlock() noexcept
+{
+	if (!locked_)
+		return;
+
+	if (locked_pixels_)
+	{
+		const auto row_size = sizeof(image::pixel_type) * size_.x;
+		for (unsigned y = 0; y < size_.y; y++)
+			std::memcpy(static_cast<std::byte*>(locked_pixels_) + static_cast<ptrdiff_t>(y) * locked_pitch_,
+						&img_(0, y),
+						row_size);
+		locked_pixels_ = {};
+	}
 
-	assert(static_cast<size_t>(pitch) == sizeof(image::pixel_type) * img_.size().x);
-	std::memcpy(pixels, img_.data(), sizeof(image::pixel_type) * img_.size().x * img_.size().y);
+	SDL_UnlockTexture(static_cast<SDL_Texture*>(handle_));
+	locked_ = false;
 }
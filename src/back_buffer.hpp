@@ -2,11 +2,19 @@
 #include "image.hpp"
 namespace rt
 {
+	// a streaming texture that renderers draw into. when the texture's memory has a compatible layout
+	// (which is always the case for the packed rgba format used here), lock() hands out a view of the
+	// texture memory itself so nothing is copied; otherwise rendering goes into an intermediate image
+	// that unlock() uploads.
 	class back_buffer
 	{
 	  private:
-		rt::image img_;
-		void* handle_ = {};
+		rt::image img_; // only allocated if the texture memory can't be written to directly
+		void* handle_		 = {};
+		vec2u size_			 = {};
+		void* locked_pixels_ = {};
+		int locked_pitch_	 = {};
+		bool locked_		 = false;
 
 	  public:
 		MUU_NODISCARD_CTOR
@@ -25,13 +33,13 @@ namespace rt
 		MUU_PURE_INLINE_GETTER
 		explicit operator bool() const noexcept
 		{
-			return img_ && handle_;
+			return handle_ && size_.x && size_.y;
 		}
 
 		MUU_PURE_INLINE_GETTER
-		rt::image& image() noexcept
+		const vec2u& size() const noexcept
 		{
-			return img_;
+			return size_;
 		}
 
 		MUU_PURE_INLINE_GETTER
@@ -40,7 +48,12 @@ namespace rt
 			return handle_;
 		}
 
-		void flush();
+		// locks the texture and returns the view renderers should write to. every pixel must be written;
+		// the texture's previous contents are not preserved.
+		MUU_NODISCARD
+		image_view lock();
+
+		void unlock() noexcept;
 	};
 
 	static_assert(!std::is_copy_constructible_v<back_buffer>);
@@ -0,0 +1,296 @@
+#include "bvh.hpp"
+MUU_DISABLE_WARNINGS;
+#include <numeric>
+#include <array>
+MUU_ENABLE_WARNINGS;
+
+MUU_FORCE_NDEBUG_OPTIMIZATIONS;
+
+using namespace rt;
+
+namespace
+{
+	static constexpr uint32_t sah_bins		  = 16;
+	static constexpr float sah_traverse_cost  = 1.0f; // relative to the cost of a single leaf batch test
+	static constexpr unsigned sah_depth_limit = 32;	  // switch to median splits past this to keep the tree shallow
+	static_assert(sah_depth_limit < bvh::max_depth);
+	static constexpr float refit_max_growth	  = 1.5f; // node surface area growth since build() before refits give up
+
+	// leaves are tested by the simd kernels max_leaf_size primitives at a time,
+	// so a partially-filled batch costs the same as a full one
+	MUU_CONST_INLINE_GETTER
+	static float leaf_cost(uint32_t count) noexcept
+	{
+		return static_cast<float>((count + bvh::max_leaf_size - 1u) / bvh::max_leaf_size);
+	}
+
+	struct aabb
+	{
+		vec3 min = vec3{ floats::highest };
+		vec3 max = vec3{ floats::lowest };
+
+		MUU_ALWAYS_INLINE
+		void grow(const vec3& pt) noexcept
+		{
+			min = vec3::min(min, pt);
+			max = vec3::max(max, pt);
+		}
+
+		MUU_ALWAYS_INLINE
+		void grow(const aabb& bb) noexcept
+		{
+			min = vec3::min(min, bb.min);
+			max = vec3::max(max, bb.max);
+		}
+
+		MUU_PURE_INLINE_GETTER
+		float area() const noexcept
+		{
+			const auto d = max - min;
+			if (d.x < 0.0f || d.y < 0.0f || d.z < 0.0f)
+				return 0.0f;
+			return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+		}
+	};
+
+	struct builder
+	{
+		std::vector<bvh_node>& nodes;
+		std::vector<uint32_t>& order;
+		std::vector<aabb> bounds;
+		std::vector<vec3> centroids;
+
+		void build(uint32_t node_index, uint32_t begin, uint32_t end, unsigned depth)
+		{
+			assert(node_index + 1u == nodes.size());
+			assert(end > begin);
+
+			aabb node_bounds, centroid_bounds;
+			for (auto i = begin; i < end; i++)
+			{
+				node_bounds.grow(bounds[order[i]]);
+				centroid_bounds.grow(centroids[order[i]]);
+			}
+			nodes[node_index].min = node_bounds.min;
+			nodes[node_index].max = node_bounds.max;
+
+			const auto make_leaf = [&]() noexcept
+			{
+				nodes[node_index].index = begin;
+				nodes[node_index].count = end - begin;
+			};
+
+			// bvh::traverse() keeps a fixed-size stack of max_depth entries and pushes at most one per interior node on
+			// the way down, so nothing may be split this deep no matter how many primitives are left
+			const auto count = end - begin;
+			if (count == 1u || depth + 1u >= bvh::max_depth)
+				return make_leaf();
+
+			// find the cheapest binned split across all three axes
+			const auto extent = centroid_bounds.max - centroid_bounds.min;
+			float best_cost	  = floats::highest;
+			size_t best_axis  = 0;
+			uint32_t best_bin = 0;
+			if (depth < sah_depth_limit)
+			{
+				const auto parent_area = node_bounds.area();
+
+				for (size_t axis = 0; axis < 3; axis++)
+				{
+					if (extent[axis] <= 1e-6f)
+						continue;
+
+					struct bin
+					{
+						aabb bounds;
+						uint32_t count;
+					};
+					std::array<bin, sah_bins> bins{};
+					const auto scale = static_cast<float>(sah_bins) / extent[axis];
+					for (auto i = begin; i < end; i++)
+					{
+						const auto b = std::min(
+							static_cast<uint32_t>((centroids[order[i]][axis] - centroid_bounds.min[axis]) * scale),
+							sah_bins - 1u);
+						bins[b].bounds.grow(bounds[order[i]]);
+						bins[b].count++;
+					}
+
+					// sweep from the right to get the cost of everything above each split plane
+					std::array<float, sah_bins - 1u> right_cost{};
+					aabb right;
+					uint32_t right_count = 0;
+					for (auto b = sah_bins - 1u; b > 0u; b--)
+					{
+						right.grow(bins[b].bounds);
+						right_count += bins[b].count;
+						right_cost[b - 1u] = right.area() * leaf_cost(right_count);
+					}
+
+					aabb left;
+					uint32_t left_count = 0;
+					for (uint32_t b = 0; b < sah_bins - 1u; b++)
+					{
+						left.grow(bins[b].bounds);
+						left_count += bins[b].count;
+						if (!left_count || left_count == count)
+							continue;
+
+						const auto cost =
+							sah_traverse_cost
+							+ (left.area() * leaf_cost(left_count) + right_cost[b]) / parent_area;
+						if (cost < best_cost)
+						{
+							best_cost = cost;
+							best_axis = axis;
+							best_bin  = b;
+						}
+					}
+				}
+
+				if (count <= bvh::max_leaf_size && best_cost >= leaf_cost(count))
+					return make_leaf();
+			}
+			else if (count <= bvh::max_leaf_size)
+				return make_leaf();
+
+			auto mid = begin;
+			if (best_cost < floats::highest)
+			{
+				const auto scale = static_cast<float>(sah_bins) / extent[best_axis];
+				const auto pivot = std::partition(order.data() + begin,
+												  order.data() + end,
+												  [&](uint32_t prim) noexcept
+												  {
+													  const auto b = static_cast<uint32_t>(
+														  (centroids[prim][best_axis] - centroid_bounds.min[best_axis])
+														  * scale);
+													  return std::min(b, sah_bins - 1u) <= best_bin;
+												  });
+				mid				 = static_cast<uint32_t>(pivot - order.data());
+			}
+
+			// no usable split (or too deep); fall back to an object median along the widest axis
+			if (mid == begin || mid == end)
+			{
+				size_t axis = 0;
+				if (extent.y > extent[axis])
+					axis = 1;
+				if (extent.z > extent[axis])
+					axis = 2;
+
+				mid = begin + count / 2u;
+				std::nth_element(order.data() + begin,
+								 order.data() + mid,
+								 order.data() + end,
+								 [&](uint32_t lhs, uint32_t rhs) noexcept
+								 { return centroids[lhs][axis] < centroids[rhs][axis]; });
+			}
+
+			nodes[node_index].count = 0;
+
+			const auto left_index = static_cast<uint32_t>(nodes.size());
+			nodes.emplace_back();
+			build(left_index, begin, mid, depth + 1u);
+
+			const auto right_index	= static_cast<uint32_t>(nodes.size());
+			nodes[node_index].index = right_index;
+			nodes.emplace_back();
+			build(right_index, mid, end, depth + 1u);
+		}
+	};
+}
+
+std::vector<uint32_t> bvh::build(std::span<const box> prims)
+{
+	clear();
+
+	std::vector<uint32_t> order(prims.size());
+	std::iota(order.begin(), order.end(), 0u);
+	if (prims.empty())
+		return order;
+
+	auto b = builder{ nodes_, order, {}, {} };
+	b.bounds.reserve(prims.size());
+	b.centroids.reserve(prims.size());
+	for (const auto& prim : prims)
+	{
+		b.bounds.push_back(aabb{ prim.center - prim.extents, prim.center + prim.extents });
+		b.centroids.push_back(prim.center);
+	}
+
+	nodes_.reserve(prims.size() * 2u);
+	nodes_.emplace_back();
+	b.build(0, 0, static_cast<uint32_t>(prims.size()), 0);
+	nodes_.shrink_to_fit();
+
+	bounds_.clear();
+	bounds_.reserve(prims.size());
+	for (const auto i : order)
+		bounds_.push_back(prims[i]);
+
+	built_area_ = 0.0f;
+	for (const auto& node : nodes_)
+		built_area_ += aabb{ node.min, node.max }.area();
+	area_ = built_area_;
+
+	return order;
+}
+
+bool bvh::refit(std::span<const box> prims)
+{
+	assert(!nodes_.empty());
+	assert(prims.size() == bounds_.size());
+
+	// children always come after their parent, so walking backwards visits both children before the parent.
+	// a node's bounds can only have changed if something beneath it did, so clean subtrees are skipped entirely.
+	std::vector<uint8_t> dirty(nodes_.size());
+	for (auto i = nodes_.size(); i-- > 0u;)
+	{
+		auto& node = nodes_[i];
+
+		aabb bb;
+		if (node.count)
+		{
+			assert(node.index + node.count <= prims.size());
+			for (auto p = node.index, e = node.index + node.count; p < e; p++)
+			{
+				if (prims[p].center != bounds_[p].center || prims[p].extents != bounds_[p].extents)
+				{
+					bounds_[p] = prims[p];
+					dirty[i]   = 1;
+				}
+			}
+			if (!dirty[i])
+				continue;
+
+			for (auto p = node.index, e = node.index + node.count; p < e; p++)
+				bb.grow(aabb{ prims[p].center - prims[p].extents, prims[p].center + prims[p].extents });
+		}
+		else
+		{
+			if (!dirty[i + 1u] && !dirty[node.index])
+				continue;
+			dirty[i] = 1;
+
+			bb.grow(aabb{ nodes_[i + 1u].min, nodes_[i + 1u].max });
+			bb.grow(aabb{ nodes_[node.index].min, nodes_[node.index].max });
+		}
+
+		area_ += bb.area() - aabb{ node.min, node.max }.area();
+		node.min = bb.min;
+		node.max = bb.max;
+	}
+
+	// compared against the tree as it was built rather than as of the last refit,
+	// otherwise a series of refits could each loosen it a little and it would never be rebuilt
+	return area_ <= built_area_ * refit_max_growth;
+}
+
+void bvh::clear() noexcept
+{
+	nodes_.clear();
+	bounds_.clear();
+	built_area_ = 0.0f;
+	area_		= 0.0f;
+}
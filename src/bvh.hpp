@@ -0,0 +1,156 @@
+#pragma once
+#include "common.hpp"
+MUU_DISABLE_WARNINGS;
+#include <vector>
+#include <span>
+#include <algorithm>
+MUU_ENABLE_WARNINGS;
+
+namespace rt
+{
+	// nodes are stored depth-first, so the first child of an interior node is always the node immediately after it
+	// and only the second child's index needs to be stored. two nodes fit in a cache line.
+	struct bvh_node
+	{
+		vec3 min;
+		uint32_t index; // leaf: first primitive, interior: second child
+		vec3 max;
+		uint32_t count; // leaf: number of primitives, interior: zero
+	};
+	static_assert(sizeof(bvh_node) == 32);
+
+	namespace detail
+	{
+		MUU_PURE_INLINE_GETTER
+		vec3 MUU_VECTORCALL bvh_inverse_direction(const vec3& dir) noexcept
+		{
+			// -ffast-math means we can't rely on infinities, so clamp tiny components before taking the reciprocal
+			const auto safe = [](float f) noexcept { return muu::abs(f) < 1e-8f ? (f < 0.0f ? -1e-8f : 1e-8f) : f; };
+			return vec3{ 1.0f / safe(dir.x), 1.0f / safe(dir.y), 1.0f / safe(dir.z) };
+		}
+
+		MUU_ALWAYS_INLINE
+		bool MUU_VECTORCALL bvh_slab_test(const bvh_node& node,
+										  const vec3& origin,
+										  const vec3& inv_dir,
+										  float max_dist,
+										  float& entry_dist) noexcept
+		{
+			const auto t0	 = (node.min - origin) * inv_dir;
+			const auto t1	 = (node.max - origin) * inv_dir;
+			const auto near_ = vec3::min(t0, t1);
+			const auto far_	 = vec3::max(t0, t1);
+			entry_dist		 = std::max(std::max(near_.x, near_.y), std::max(near_.z, 0.0f));
+			return entry_dist <= std::min(std::min(far_.x, far_.y), std::min(far_.z, max_dist));
+		}
+	}
+
+	class bvh
+	{
+	  public:
+		static constexpr uint32_t max_leaf_size = 8;
+		static constexpr uint32_t max_depth		= 64; // build() makes a leaf of anything that reaches this depth
+
+	  private:
+		std::vector<bvh_node> nodes_;
+		std::vector<box> bounds_; // primitive bounds in stored order, as of the last build() or refit()
+		float built_area_ = 0.0f; // total node surface area as of the last build(), for deciding when refits are done
+		float area_		  = 0.0f; // total node surface area as it is now
+
+	  public:
+		// builds the hierarchy using the surface area heuristic.
+		// returns the order the primitives must be stored in for leaf ranges to be contiguous,
+		// i.e. result[i] is the source index of the primitive that belongs at position i.
+		std::vector<uint32_t> build(std::span<const box> bounds);
+
+		// updates the node bounds for primitives that have moved, keeping the tree's shape.
+		// bounds must be given in the order build() returned (i.e. the order the primitives are stored in).
+		// only the leaves holding primitives whose bounds differ from last time (and the nodes above them) are touched.
+		// returns false if the tree has loosened enough since it was built that it should be rebuilt instead.
+		bool refit(std::span<const box> bounds);
+
+		void clear() noexcept;
+
+		MUU_PURE_INLINE_GETTER
+		bool empty() const noexcept
+		{
+			return nodes_.empty();
+		}
+
+		MUU_PURE_INLINE_GETTER
+		std::span<const bvh_node> nodes() const noexcept
+		{
+			return { nodes_.data(), nodes_.size() };
+		}
+
+		// calls leaf_func(first, count) for every leaf the ray passes through, nearest-first.
+		// leaf_func is expected to shrink max_dist as it finds closer hits, or set it below zero to stop early.
+		template <typename Func>
+		MUU_ALWAYS_INLINE
+		void MUU_VECTORCALL traverse(const ray& r, float& max_dist, Func&& leaf_func) const noexcept
+		{
+			if (nodes_.empty())
+				return;
+
+			const auto inv_dir = detail::bvh_inverse_direction(r.direction);
+			const auto nodes   = nodes_.data();
+
+			float dist;
+			if (!detail::bvh_slab_test(nodes[0], r.origin, inv_dir, max_dist, dist))
+				return;
+
+			struct stack_entry
+			{
+				uint32_t index;
+				float dist;
+			};
+			stack_entry stack[max_depth];
+			uint32_t stack_size = 0;
+			uint32_t index		= 0;
+
+			while (true)
+			{
+				const auto& node = nodes[index];
+				if (node.count)
+					leaf_func(node.index, node.count);
+				else
+				{
+					auto a = stack_entry{ index + 1u, 0.0f };
+					auto b = stack_entry{ node.index, 0.0f };
+					const auto hit_a =
+						detail::bvh_slab_test(nodes[a.index], r.origin, inv_dir, max_dist, a.dist);
+					const auto hit_b =
+						detail::bvh_slab_test(nodes[b.index], r.origin, inv_dir, max_dist, b.dist);
+
+					if (hit_a && hit_b)
+					{
+						if (b.dist < a.dist)
+							std::swap(a, b);
+						assert(stack_size < max_depth); // can't fail; build() never nests interior nodes this deep
+						stack[stack_size++] = b;
+						index				= a.index;
+						continue;
+					}
+					if (hit_a || hit_b)
+					{
+						index = hit_a ? a.index : b.index;
+						continue;
+					}
+				}
+
+				// pop the next node, skipping any that are now further away than the closest hit
+				while (true)
+				{
+					if (!stack_size)
+						return;
+					const auto& entry = stack[--stack_size];
+					if (entry.dist <= max_dist)
+					{
+						index = entry.index;
+						break;
+					}
+				}
+			}
+		}
+	};
+}
@@ -65,6 +65,7 @@ namespace rt
 
 	struct colour;
 	struct scene;
+	struct frame_settings;
 	struct viewport;
 	struct window_events;
 	struct renderer_interface;
@@ -74,12 +75,14 @@ namespace rt
 	class image_view;
 	class camera;
 	class back_buffer;
+	class render_control;
 
 	// soa:
 	class materials;
 	class planes;
 	class spheres;
 	class boxes;
+	class triangles;
 
 	inline namespace literals
 	{
@@ -113,4 +116,20 @@ namespace rt
 		ice,
 		diamond,
 	};
+
+	// materials whose reflectivity column holds an index of refraction rather than a reflectivity.
+	// diamond isn't implemented yet, so like any other unimplemented type it's shaded as lambert.
+	MUU_CONST_INLINE_GETTER
+	constexpr bool is_dielectric(material_type type) noexcept
+	{
+		switch (type)
+		{
+			case material_type::dielectric:
+			case material_type::air:
+			case material_type::vacuum:
+			case material_type::water:
+			case material_type::ice: return true;
+			default: return false;
+		}
+	}
 }
@@ -38,6 +38,13 @@ image& image::clear(uint32_t colour) noexcept
 
 image_view& image_view::clear(uint32_t colour) noexcept
 {
-	std::fill(data_, data_ + (size_.x * size_.y), colour);
+	if (stride_ == size_.x)
+	{
+		std::fill(data_, data_ + (size_.x * size_.y), colour);
+		return *this;
+	}
+
+	for (unsigned y = 0; y < size_.y; y++)
+		std::fill(data_ + y * stride_, data_ + y * stride_ + size_.x, colour);
 	return *this;
 }
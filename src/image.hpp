@@ -98,6 +98,7 @@ namespace rt
 	  private:
 		pixel_type* data_ = {};
 		vec2u size_		  = {};
+		unsigned stride_  = {}; // distance between the starts of two rows, in pixels
 
 	  public:
 		MUU_NODISCARD_CTOR
@@ -106,13 +107,25 @@ namespace rt
 		MUU_NODISCARD_CTOR
 		image_view(pixel_type* img, vec2u sz) noexcept //
 			: data_{ img },
-			  size_{ sz }
+			  size_{ sz },
+			  stride_{ sz.x }
 		{}
 
+		// for memory whose rows are padded, e.g. a locked texture
+		MUU_NODISCARD_CTOR
+		image_view(pixel_type* img, vec2u sz, unsigned stride) noexcept //
+			: data_{ img },
+			  size_{ sz },
+			  stride_{ stride }
+		{
+			assert(stride >= sz.x);
+		}
+
 		MUU_NODISCARD_CTOR
 		image_view(image& img) noexcept //
 			: data_{ img.data() },
-			  size_{ img.size() }
+			  size_{ img.size() },
+			  stride_{ img.size().x }
 		{}
 
 		MUU_NODISCARD_CTOR
@@ -134,6 +147,12 @@ namespace rt
 			return size_;
 		}
 
+		MUU_PURE_INLINE_GETTER
+		constexpr unsigned stride() const noexcept
+		{
+			return stride_;
+		}
+
 		MUU_PURE_INLINE_GETTER
 		constexpr pixel_type* data() const noexcept
 		{
@@ -143,7 +162,7 @@ namespace rt
 		MUU_PURE_INLINE_GETTER
 		constexpr pixel_type& operator()(unsigned x, unsigned y) const noexcept
 		{
-			return *(data_ + (y * size_.x + x));
+			return *(data_ + (y * stride_ + x));
 		}
 
 		MUU_PURE_INLINE_GETTER
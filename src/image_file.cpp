@@ -0,0 +1,220 @@
+#include "image_file.hpp"
+MUU_DISABLE_WARNINGS;
+#include <array>
+#include <vector>
+#include <span>
+#include <string>
+#include <fstream>
+#include <stdexcept>
+#include <filesystem>
+#include <bit>
+#include <cctype>
+MUU_ENABLE_WARNINGS;
+
+using namespace rt;
+namespace fs = std::filesystem;
+
+namespace
+{
+	using bytes = std::vector<uint8_t>;
+
+	MUU_CONST_INLINE_GETTER
+	static constexpr uint8_t red(uint32_t px) noexcept
+	{
+		return static_cast<uint8_t>(px >> 24);
+	}
+
+	MUU_CONST_INLINE_GETTER
+	static constexpr uint8_t green(uint32_t px) noexcept
+	{
+		return static_cast<uint8_t>(px >> 16);
+	}
+
+	MUU_CONST_INLINE_GETTER
+	static constexpr uint8_t blue(uint32_t px) noexcept
+	{
+		return static_cast<uint8_t>(px >> 8);
+	}
+
+	MUU_CONST_INLINE_GETTER
+	static constexpr uint8_t alpha(uint32_t px) noexcept
+	{
+		return static_cast<uint8_t>(px);
+	}
+
+	static void append(bytes& buf, std::string_view str)
+	{
+		for (auto c : str)
+			buf.push_back(static_cast<uint8_t>(c));
+	}
+
+	static void append_u32_be(bytes& buf, uint32_t val)
+	{
+		buf.push_back(static_cast<uint8_t>(val >> 24));
+		buf.push_back(static_cast<uint8_t>(val >> 16));
+		buf.push_back(static_cast<uint8_t>(val >> 8));
+		buf.push_back(static_cast<uint8_t>(val));
+	}
+
+	static constexpr auto crc_table = []() noexcept
+	{
+		std::array<uint32_t, 256> table{};
+		for (uint32_t i = 0; i < 256u; i++)
+		{
+			auto c = i;
+			for (int k = 0; k < 8; k++)
+				c = (c & 1u) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			table[i] = c;
+		}
+		return table;
+	}();
+
+	MUU_PURE_GETTER
+	static uint32_t crc32(const uint8_t* data, size_t size) noexcept
+	{
+		auto c = 0xFFFFFFFFu;
+		for (size_t i = 0; i < size; i++)
+			c = crc_table[(c ^ data[i]) & 0xFFu] ^ (c >> 8);
+		return c ^ 0xFFFFFFFFu;
+	}
+
+	static void append_png_chunk(bytes& buf, std::string_view type, const bytes& data)
+	{
+		append_u32_be(buf, static_cast<uint32_t>(data.size()));
+		const auto crc_start = buf.size();
+		append(buf, type);
+		buf.insert(buf.end(), data.begin(), data.end());
+		append_u32_be(buf, crc32(buf.data() + crc_start, buf.size() - crc_start));
+	}
+
+	// png with the image data stored in uncompressed deflate blocks; larger than it needs to be,
+	// but every decoder reads it and it doesn't need a zlib dependency.
+	MUU_NODISCARD
+	static bytes encode_png(const image_view& img)
+	{
+		const auto width  = img.size().x;
+		const auto height = img.size().y;
+
+		// each scanline is prefixed with its filter type (0: none)
+		bytes raw;
+		raw.reserve((width * 4u + 1u) * height);
+		for (unsigned y = 0; y < height; y++)
+		{
+			raw.push_back(0);
+			for (unsigned x = 0; x < width; x++)
+			{
+				const auto px = img(x, y);
+				raw.insert(raw.end(), { red(px), green(px), blue(px), alpha(px) });
+			}
+		}
+
+		bytes zlib{ 0x78u, 0x01u };
+		uint32_t adler_a = 1, adler_b = 0;
+		for (size_t pos = 0; pos < raw.size();)
+		{
+			const auto len	= static_cast<uint16_t>(std::min(raw.size() - pos, size_t{ 65535 }));
+			const auto nlen = static_cast<uint16_t>(~len);
+			const auto last = pos + len >= raw.size();
+			zlib.push_back(static_cast<uint8_t>(last ? 1u : 0u));
+			zlib.push_back(static_cast<uint8_t>(len));
+			zlib.push_back(static_cast<uint8_t>(len >> 8));
+			zlib.push_back(static_cast<uint8_t>(nlen));
+			zlib.push_back(static_cast<uint8_t>(nlen >> 8));
+			for (size_t i = pos, e = pos + len; i < e; i++)
+			{
+				zlib.push_back(raw[i]);
+				adler_a = (adler_a + raw[i]) % 65521u;
+				adler_b = (adler_b + adler_a) % 65521u;
+			}
+			pos += len;
+		}
+		append_u32_be(zlib, (adler_b << 16) | adler_a);
+
+		bytes ihdr;
+		append_u32_be(ihdr, width);
+		append_u32_be(ihdr, height);
+		ihdr.insert(ihdr.end(), { 8u, 6u, 0u, 0u, 0u }); // 8 bits per channel, RGBA, deflate, no filter, no interlace
+
+		bytes png{ 0x89u, 'P', 'N', 'G', '\r', '\n', 0x1Au, '\n' };
+		append_png_chunk(png, "IHDR"sv, ihdr);
+		append_png_chunk(png, "IDAT"sv, zlib);
+		append_png_chunk(png, "IEND"sv, {});
+		return png;
+	}
+
+	MUU_NODISCARD
+	static bytes encode_ppm(const image_view& img)
+	{
+		bytes ppm;
+		append(ppm, "P6\n"s + std::to_string(img.size().x) + " "s + std::to_string(img.size().y) + "\n255\n"s);
+		ppm.reserve(ppm.size() + img.size().x * img.size().y * 3u);
+		for (unsigned y = 0; y < img.size().y; y++)
+		{
+			for (unsigned x = 0; x < img.size().x; x++)
+			{
+				const auto px = img(x, y);
+				ppm.insert(ppm.end(), { red(px), green(px), blue(px) });
+			}
+		}
+		return ppm;
+	}
+
+	// pfm stores little-endian floats, bottom row first
+	MUU_NODISCARD
+	static bytes encode_pfm(std::span<const vec3> linear, vec2u size)
+	{
+		static_assert(std::endian::native == std::endian::little);
+		assert(linear.size() == size.x * size.y);
+
+		bytes pfm;
+		append(pfm, "PF\n"s + std::to_string(size.x) + " "s + std::to_string(size.y) + "\n-1.0\n"s);
+		pfm.reserve(pfm.size() + size.x * size.y * 3u * sizeof(float));
+		for (unsigned y = size.y; y-- > 0u;)
+		{
+			for (unsigned x = 0; x < size.x; x++)
+			{
+				const auto& px = linear[y * size.x + x];
+				for (auto f : { px.x, px.y, px.z })
+				{
+					const auto bits = muu::bit_cast<std::array<uint8_t, sizeof(float)>>(f);
+					pfm.insert(pfm.end(), bits.begin(), bits.end());
+				}
+			}
+		}
+		return pfm;
+	}
+}
+
+void rt::save_image(const image_view& img, std::string_view path_sv, std::span<const vec3> linear)
+{
+	if (!img)
+		throw std::runtime_error{ "cannot save an empty image" };
+
+	const auto path = fs::path{ path_sv };
+	auto ext		= path.extension().string();
+	for (auto& c : ext)
+		c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+
+	bytes data;
+	if (ext == ".png"sv)
+		data = encode_png(img);
+	else if (ext == ".ppm"sv)
+		data = encode_ppm(img);
+	else if (ext == ".pfm"sv)
+	{
+		// squaring the 8-bit image back to linear would just be a worse png, so this needs the real thing
+		if (linear.size() != img.size().x * img.size().y)
+			throw std::runtime_error{ "'.pfm' output needs a renderer that keeps a linear image (e.g. mg_ray_tracer)" };
+		data = encode_pfm(linear, img.size());
+	}
+	else
+		throw std::runtime_error{ "unsupported image format '"s + ext + "' (expected .png, .ppm or .pfm)"s };
+
+	std::ofstream file{ path, std::ios::binary | std::ios::trunc };
+	if (!file)
+		throw std::runtime_error{ "could not open '"s + path.string() + "' for writing"s };
+
+	file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+	if (!file)
+		throw std::runtime_error{ "failed writing '"s + path.string() + "'"s };
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include "image.hpp"
+MUU_DISABLE_WARNINGS;
+#include <span>
+MUU_ENABLE_WARNINGS;
+
+namespace rt
+{
+	// writes an image to disk, picking the format from the file extension:
+	//   .png  8-bit RGBA
+	//   .ppm  8-bit RGB (binary P6)
+	//   .pfm  32-bit float RGB, from linear (see renderer_interface::linear_image()). throws if that's empty.
+	// throws std::runtime_error on failure.
+	void save_image(const image_view& img, std::string_view path, std::span<const vec3> linear = {});
+}
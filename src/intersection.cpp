@@ -0,0 +1,987 @@
+#include "intersection.hpp"
+#include "scene.hpp"
+MUU_DISABLE_WARNINGS;
+#include <bit>
+#include <iterator>
+#include <atomic>
+#include <algorithm>
+#include <xsimd/xsimd.hpp>
+MUU_ENABLE_WARNINGS;
+
+MUU_FORCE_NDEBUG_OPTIMIZATIONS;
+
+using namespace rt;
+
+namespace
+{
+	using batch		 = simd_float;
+	using batch_bool = simd_float::batch_bool_type;
+	static_assert(batch::size <= simd_padding);
+
+	alignas(64) static constexpr float lane_index_values[] = { 0.0f, 1.0f, 2.0f,  3.0f,  4.0f,  5.0f,  6.0f,  7.0f,
+															   8.0f, 9.0f, 10.0f, 11.0f, 12.0f, 13.0f, 14.0f, 15.0f };
+	static_assert(std::size(lane_index_values) >= batch::size);
+
+	// soa.toml aligns the float columns to 32 bytes, which covers a full batch on anything up to AVX2
+	static constexpr bool columns_are_batch_aligned = batch::size * sizeof(float) <= 32u;
+
+	MUU_PURE_INLINE_GETTER
+	static batch MUU_VECTORCALL load_column(const float* column, size_t index) noexcept
+	{
+		assert(index % batch::size == 0u);
+
+		if constexpr (columns_are_batch_aligned)
+			return xsimd::load_aligned(column + index);
+		else
+			return xsimd::load_unaligned(column + index);
+	}
+
+	MUU_PURE_INLINE_GETTER
+	static batch_bool MUU_VECTORCALL lanes_below(size_t count) noexcept
+	{
+		return xsimd::load_aligned(lane_index_values) < batch{ static_cast<float>(count) };
+	}
+
+	MUU_PURE_INLINE_GETTER
+	static batch MUU_VECTORCALL safe_reciprocal(float f) noexcept
+	{
+		// -ffast-math means we can't rely on infinities, so clamp tiny values before taking the reciprocal
+		return batch{ 1.0f / (muu::abs(f) < 1e-8f ? (f < 0.0f ? -1e-8f : 1e-8f) : f) };
+	}
+
+	// a single ray broadcast across all lanes
+	struct ray_batch
+	{
+		batch origin_x, origin_y, origin_z;
+		batch dir_x, dir_y, dir_z;
+		batch inv_dir_x, inv_dir_y, inv_dir_z;
+
+		MUU_NODISCARD_CTOR
+		explicit ray_batch(const ray& r) noexcept
+			: origin_x{ r.origin.x },
+			  origin_y{ r.origin.y },
+			  origin_z{ r.origin.z },
+			  dir_x{ r.direction.x },
+			  dir_y{ r.direction.y },
+			  dir_z{ r.direction.z },
+			  inv_dir_x{ safe_reciprocal(r.direction.x) },
+			  inv_dir_y{ safe_reciprocal(r.direction.y) },
+			  inv_dir_z{ safe_reciprocal(r.direction.z) }
+		{}
+	};
+
+	enum class primitive_kind : uint8_t
+	{
+		none,
+		plane,
+		sphere,
+		box,
+		triangle,
+		instance
+	};
+
+	// the closest hit found so far along a single ray. it's carried through every acceleration structure in turn so
+	// each one can skip anything further away than what the others already found.
+	struct ray_hits
+	{
+		float dist			  = floats::highest;
+		primitive_kind kind	  = primitive_kind::none;
+		size_t index		  = {};
+		size_t instance_index = {}; // only meaningful for primitive_kind::instance
+	};
+
+	// folds a batch of candidate distances into the running closest hit (horizontal min-reduction)
+	MUU_ALWAYS_INLINE
+	static void MUU_VECTORCALL closest_lane(batch dist, size_t first, primitive_kind kind, ray_hits& hits) noexcept
+	{
+		const auto nearest = xsimd::reduce_min(dist);
+		if (nearest >= hits.dist)
+			return;
+
+		hits.index = first + static_cast<size_t>(std::countr_zero((dist == batch{ nearest }).mask()));
+		hits.dist  = nearest;
+		hits.kind  = kind;
+	}
+
+	// the face we hit is the one whose axis the hit point is furthest along, relative to the box's extents
+	MUU_PURE_GETTER
+	static vec3 MUU_VECTORCALL box_normal(const box& bb, const vec3& point) noexcept
+	{
+		const auto local	 = (point - bb.center) / vec3::max(bb.extents, vec3{ 1e-6f });
+		const auto abs_local = vec3{ muu::abs(local.x), muu::abs(local.y), muu::abs(local.z) };
+		size_t axis			 = 0;
+		if (abs_local.y > abs_local[axis])
+			axis = 1;
+		if (abs_local.z > abs_local[axis])
+			axis = 2;
+
+		vec3 normal{};
+		normal[axis] = local[axis] < 0.0f ? -1.0f : 1.0f;
+		return normal;
+	}
+
+	MUU_ALWAYS_INLINE
+	static void MUU_VECTORCALL intersect_spheres(const rt::spheres& spheres,
+												 const ray_batch& r,
+												 size_t first,
+												 size_t count,
+												 ray_hits& hits) noexcept
+	{
+		MUU_FMA_BLOCK;
+
+		// leaf ranges start wherever the bvh put them, so unlike the plane table (which is always walked from row 0)
+		// these loads can't assume batch alignment. tables have simd_padding zeroed rows past their end so full-width
+		// loads never read uninitialised memory (see scene.hpp).
+		const auto center_x = spheres.center_x();
+		const auto center_y = spheres.center_y();
+		const auto center_z = spheres.center_z();
+		const auto radius	= spheres.radius();
+
+		const auto a = r.dir_x * r.dir_x + r.dir_y * r.dir_y + r.dir_z * r.dir_z;
+
+		for (size_t i = first, e = first + count; i < e; i += batch::size)
+		{
+			const auto oc_x = r.origin_x - xsimd::load_unaligned(center_x + i);
+			const auto oc_y = r.origin_y - xsimd::load_unaligned(center_y + i);
+			const auto oc_z = r.origin_z - xsimd::load_unaligned(center_z + i);
+			const auto rad	= xsimd::load_unaligned(radius + i);
+
+			const auto b	= oc_x * r.dir_x + oc_y * r.dir_y + oc_z * r.dir_z;
+			const auto c	= oc_x * oc_x + oc_y * oc_y + oc_z * oc_z - rad * rad;
+			const auto disc = b * b - a * c;
+
+			auto valid = lanes_below(e - i) & (disc >= batch{ 0.0f });
+			if (xsimd::none(valid))
+				continue;
+
+			// nearest root in front of the ray, or the far root if we're inside the sphere
+			const auto root = xsimd::sqrt(xsimd::max(disc, batch{ 0.0f }));
+			const auto t0	= (-b - root) / a;
+			const auto t1	= (-b + root) / a;
+			const auto t	= xsimd::select(t0 >= batch{ min_hit_dist }, t0, t1);
+
+			valid = valid & (t >= batch{ min_hit_dist }) & (t < batch{ hits.dist });
+			if (xsimd::any(valid))
+				closest_lane(xsimd::select(valid, t, batch{ floats::highest }), i, primitive_kind::sphere, hits);
+		}
+	}
+
+	MUU_ALWAYS_INLINE
+	static void MUU_VECTORCALL intersect_boxes(const rt::boxes& boxes,
+											   const ray_batch& r,
+											   size_t first,
+											   size_t count,
+											   ray_hits& hits) noexcept
+	{
+		MUU_FMA_BLOCK;
+
+		const auto center_x	 = boxes.center_x();
+		const auto center_y	 = boxes.center_y();
+		const auto center_z	 = boxes.center_z();
+		const auto extents_x = boxes.extents_x();
+		const auto extents_y = boxes.extents_y();
+		const auto extents_z = boxes.extents_z();
+
+		const auto slab =
+			[](batch center, batch extents, batch origin, batch inv_dir, batch& near_, batch& far_) noexcept
+		{
+			const auto t0 = (center - extents - origin) * inv_dir;
+			const auto t1 = (center + extents - origin) * inv_dir;
+			near_		  = xsimd::min(t0, t1);
+			far_		  = xsimd::max(t0, t1);
+		};
+
+		for (size_t i = first, e = first + count; i < e; i += batch::size)
+		{
+			batch near_x, far_x, near_y, far_y, near_z, far_z;
+			slab(xsimd::load_unaligned(center_x + i),
+				 xsimd::load_unaligned(extents_x + i),
+				 r.origin_x,
+				 r.inv_dir_x,
+				 near_x,
+				 far_x);
+			slab(xsimd::load_unaligned(center_y + i),
+				 xsimd::load_unaligned(extents_y + i),
+				 r.origin_y,
+				 r.inv_dir_y,
+				 near_y,
+				 far_y);
+			slab(xsimd::load_unaligned(center_z + i),
+				 xsimd::load_unaligned(extents_z + i),
+				 r.origin_z,
+				 r.inv_dir_z,
+				 near_z,
+				 far_z);
+
+			const auto t_near = xsimd::max(xsimd::max(near_x, near_y), near_z);
+			const auto t_far  = xsimd::min(xsimd::min(far_x, far_y), far_z);
+
+			// entry point if it's in front of the ray, otherwise the exit point (i.e. we're inside the box)
+			const auto t = xsimd::select(t_near >= batch{ min_hit_dist }, t_near, t_far);
+
+			const auto valid = lanes_below(e - i) & (t_near <= t_far) & (t >= batch{ min_hit_dist })
+							 & (t < batch{ hits.dist });
+			if (xsimd::any(valid))
+				closest_lane(xsimd::select(valid, t, batch{ floats::highest }), i, primitive_kind::box, hits);
+		}
+	}
+
+	// moller-trumbore. triangles are two-sided so rays can leave dielectric meshes the same way they came in.
+	MUU_ALWAYS_INLINE
+	static void MUU_VECTORCALL intersect_triangles(const rt::triangles& triangles,
+												   const ray_batch& r,
+												   size_t first,
+												   size_t count,
+												   ray_hits& hits) noexcept
+	{
+		MUU_FMA_BLOCK;
+
+		for (size_t i = first, e = first + count; i < e; i += batch::size)
+		{
+			const auto e1_x = xsimd::load_unaligned(triangles.e1_x() + i);
+			const auto e1_y = xsimd::load_unaligned(triangles.e1_y() + i);
+			const auto e1_z = xsimd::load_unaligned(triangles.e1_z() + i);
+			const auto e2_x = xsimd::load_unaligned(triangles.e2_x() + i);
+			const auto e2_y = xsimd::load_unaligned(triangles.e2_y() + i);
+			const auto e2_z = xsimd::load_unaligned(triangles.e2_z() + i);
+
+			const auto p_x = r.dir_y * e2_z - r.dir_z * e2_y;
+			const auto p_y = r.dir_z * e2_x - r.dir_x * e2_z;
+			const auto p_z = r.dir_x * e2_y - r.dir_y * e2_x;
+			const auto det = e1_x * p_x + e1_y * p_y + e1_z * p_z;
+
+			// rays parallel to the triangle never hit; the determinant is swapped out so the division stays finite
+			auto valid		   = lanes_below(e - i) & (xsimd::abs(det) > batch{ 1e-12f });
+			const auto inv_det = batch{ 1.0f } / xsimd::select(valid, det, batch{ 1.0f });
+
+			const auto o_x = r.origin_x - xsimd::load_unaligned(triangles.v0_x() + i);
+			const auto o_y = r.origin_y - xsimd::load_unaligned(triangles.v0_y() + i);
+			const auto o_z = r.origin_z - xsimd::load_unaligned(triangles.v0_z() + i);
+
+			const auto u = (o_x * p_x + o_y * p_y + o_z * p_z) * inv_det;
+			valid		 = valid & (u >= batch{ 0.0f }) & (u <= batch{ 1.0f });
+			if (xsimd::none(valid))
+				continue;
+
+			const auto q_x = o_y * e1_z - o_z * e1_y;
+			const auto q_y = o_z * e1_x - o_x * e1_z;
+			const auto q_z = o_x * e1_y - o_y * e1_x;
+			const auto v   = (r.dir_x * q_x + r.dir_y * q_y + r.dir_z * q_z) * inv_det;
+			const auto t   = (e2_x * q_x + e2_y * q_y + e2_z * q_z) * inv_det;
+
+			valid = valid & (v >= batch{ 0.0f }) & (u + v <= batch{ 1.0f }) & (t >= batch{ min_hit_dist })
+				  & (t < batch{ hits.dist });
+			if (xsimd::any(valid))
+				closest_lane(xsimd::select(valid, t, batch{ floats::highest }), i, primitive_kind::triangle, hits);
+		}
+	}
+
+	// counter-clockwise winding faces outward
+	MUU_PURE_GETTER
+	static vec3 MUU_VECTORCALL triangle_normal(const rt::triangles& triangles, size_t i) noexcept
+	{
+		const auto e1 = vec3{ triangles.e1_x()[i], triangles.e1_y()[i], triangles.e1_z()[i] };
+		const auto e2 = vec3{ triangles.e2_x()[i], triangles.e2_y()[i], triangles.e2_z()[i] };
+		return vec3::normalize(vec3::cross(e1, e2));
+	}
+
+	// the direction isn't renormalized, so distances along the object-space ray are the same as in world space
+	MUU_PURE_GETTER
+	static ray MUU_VECTORCALL to_object_space(const instance& inst, const ray& r) noexcept
+	{
+		auto local		= r;
+		local.origin	= inst.to_object * (r.origin - inst.position);
+		local.direction = inst.to_object * r.direction;
+		return local;
+	}
+
+	// normals go back through the inverse transpose so non-uniform scales don't skew them
+	MUU_PURE_GETTER
+	static vec3 MUU_VECTORCALL to_world_normal(const instance& inst, const vec3& normal) noexcept
+	{
+		return vec3::normalize(mat3::transpose(inst.to_object) * normal);
+	}
+
+	// spheres and boxes share one bvh. both tables are stored in bvh order, so the primitives in a leaf are a run of
+	// rows in each, which scene::spheres_before tells us how to find.
+	struct leaf_ranges
+	{
+		size_t sphere_first, sphere_count;
+		size_t box_first, box_count;
+
+		MUU_NODISCARD_CTOR
+		leaf_ranges(const rt::scene& scene, uint32_t first, uint32_t count) noexcept
+		{
+			const auto spheres_end = scene.spheres_before[first + count];
+			sphere_first		   = scene.spheres_before[first];
+			sphere_count		   = spheres_end - sphere_first;
+			box_first			   = first - sphere_first;
+			box_count			   = count - sphere_count;
+		}
+	};
+
+	MUU_PURE_GETTER
+	static hit_result MUU_VECTORCALL resolve_hit(const rt::scene& scene,
+												 primitive_kind kind,
+												 size_t index,
+												 size_t instance_index,
+												 float dist,
+												 const vec3& point) noexcept
+	{
+		switch (kind)
+		{
+			case primitive_kind::plane:
+				return hit_result{ .distance = dist,
+								   .normal	 = scene.planes.value()[index].normal,
+								   .material = scene.planes.material()[index] };
+
+			case primitive_kind::sphere:
+				return hit_result{ .distance = dist,
+								   .normal	 = vec3::direction(scene.spheres.value()[index].center, point),
+								   .material = scene.spheres.material()[index] };
+
+			case primitive_kind::box:
+				return hit_result{ .distance = dist,
+								   .normal	 = box_normal(scene.boxes.value()[index], point),
+								   .material = scene.boxes.material()[index] };
+
+			case primitive_kind::triangle:
+				return hit_result{ .distance = dist,
+								   .normal	 = triangle_normal(scene.triangles, index),
+								   .material = scene.triangles.material()[index] };
+
+			case primitive_kind::instance:
+			{
+				const auto& inst = scene.instances[instance_index];
+				return hit_result{ .distance = dist,
+								   .normal	 = to_world_normal(inst, triangle_normal(scene.triangles, index)),
+								   .material = inst.material };
+			}
+
+			case primitive_kind::none: break;
+		}
+
+		return { -1 };
+	}
+
+	MUU_PURE_INLINE_GETTER
+	static hit_result MUU_VECTORCALL resolve_hit(const rt::scene& scene, const ray& r, const ray_hits& hits) noexcept
+	{
+		return resolve_hit(scene, hits.kind, hits.index, hits.instance_index, hits.dist, r.at(hits.dist));
+	}
+
+	// any-hit searches don't care which hit they find, so the first one ends the search.
+	// bvh::traverse() gives up as soon as its max distance goes negative, so that's how the traversal is told.
+	template <bool AnyHit>
+	MUU_ALWAYS_INLINE
+	static void stop_if_any_hit(ray_hits& hits) noexcept
+	{
+		if constexpr (AnyHit)
+		{
+			if (hits.kind != primitive_kind::none)
+				hits.dist = -1.0f;
+		}
+	}
+
+	MUU_ALWAYS_INLINE
+	static void MUU_VECTORCALL find_planes(const rt::scene& scene, const ray_batch& r, ray_hits& hits) noexcept
+	{
+		MUU_FMA_BLOCK;
+
+		const auto normal_x = scene.planes.normal_x();
+		const auto normal_y = scene.planes.normal_y();
+		const auto normal_z = scene.planes.normal_z();
+		const auto d		= scene.planes.d();
+
+		for (size_t i = 0, e = scene.planes.size(); i < e; i += batch::size)
+		{
+			const auto n_x = load_column(normal_x, i);
+			const auto n_y = load_column(normal_y, i);
+			const auto n_z = load_column(normal_z, i);
+
+			const auto denom = n_x * r.dir_x + n_y * r.dir_y + n_z * r.dir_z;
+			const auto dist	 = n_x * r.origin_x + n_y * r.origin_y + n_z * r.origin_z + load_column(d, i);
+
+			// parallel rays never hit; the denominator is swapped out so the division stays finite
+			auto valid	 = lanes_below(e - i) & (xsimd::abs(denom) > batch{ 1e-6f });
+			const auto t = -dist / xsimd::select(valid, denom, batch{ 1.0f });
+
+			valid = valid & (t >= batch{ min_hit_dist }) & (t < batch{ hits.dist });
+			if (xsimd::any(valid))
+				closest_lane(xsimd::select(valid, t, batch{ floats::highest }), i, primitive_kind::plane, hits);
+		}
+	}
+
+	template <bool AnyHit = false>
+	MUU_ALWAYS_INLINE
+	static void MUU_VECTORCALL find_primitives(const rt::scene& scene,
+											   const ray& r,
+											   const ray_batch& rb,
+											   ray_hits& hits) noexcept
+	{
+		const auto leaf_func = [&](uint32_t first, uint32_t count) noexcept
+		{
+			const auto leaf = leaf_ranges{ scene, first, count };
+			if (leaf.sphere_count)
+				intersect_spheres(scene.spheres, rb, leaf.sphere_first, leaf.sphere_count, hits);
+			if (leaf.box_count)
+				intersect_boxes(scene.boxes, rb, leaf.box_first, leaf.box_count, hits);
+			stop_if_any_hit<AnyHit>(hits);
+		};
+		scene.primitive_bvh.traverse(r, hits.dist, leaf_func);
+	}
+
+	template <bool AnyHit = false>
+	MUU_ALWAYS_INLINE
+	static void MUU_VECTORCALL find_triangles(const rt::scene& scene,
+											  const ray& r,
+											  const ray_batch& rb,
+											  ray_hits& hits) noexcept
+	{
+		for (const auto& mesh : scene.meshes)
+		{
+			// leaf ranges are relative to the mesh's first row
+			const auto leaf = [&](uint32_t first, uint32_t count) noexcept
+			{
+				intersect_triangles(scene.triangles, rb, mesh.first + first, count, hits);
+				stop_if_any_hit<AnyHit>(hits);
+			};
+			mesh.bvh.traverse(r, hits.dist, leaf);
+			if (AnyHit && hits.dist < 0.0f)
+				return;
+		}
+	}
+
+	template <bool AnyHit = false>
+	MUU_ALWAYS_INLINE
+	static void MUU_VECTORCALL find_instances(const rt::scene& scene, const ray& r, ray_hits& hits) noexcept
+	{
+		scene.instance_bvh.traverse(
+			r,
+			hits.dist,
+			[&](uint32_t first, uint32_t count) noexcept
+			{
+				for (size_t i = first, e = first + count; i < e; i++)
+				{
+					const auto& inst   = scene.instances[i];
+					const auto& object = scene.objects[inst.object];
+					const auto local   = to_object_space(inst, r);
+					const auto rb	   = ray_batch{ local };
+					const auto prev	   = hits.dist;
+
+					const auto leaf = [&](uint32_t obj_first, uint32_t obj_count) noexcept
+					{
+						intersect_triangles(scene.triangles, rb, object.first + obj_first, obj_count, hits);
+						stop_if_any_hit<AnyHit>(hits);
+					};
+					object.bvh.traverse(local, hits.dist, leaf);
+
+					// the triangle kernel recorded it as a plain triangle; it needs to know whose it was
+					if (hits.dist < prev)
+					{
+						hits.kind			= primitive_kind::instance;
+						hits.instance_index = i;
+					}
+					if (AnyHit && hits.dist < 0.0f)
+						return;
+				}
+			});
+	}
+}
+
+hit_result MUU_VECTORCALL rt::test_planes(const rt::scene& scene, const ray r) noexcept
+{
+	ray_hits hits;
+	find_planes(scene, ray_batch{ r }, hits);
+	return resolve_hit(scene, r, hits);
+}
+
+hit_result MUU_VECTORCALL rt::test_primitives(const rt::scene& scene, const ray r) noexcept
+{
+	ray_hits hits;
+	find_primitives(scene, r, ray_batch{ r }, hits);
+	return resolve_hit(scene, r, hits);
+}
+
+hit_result MUU_VECTORCALL rt::test_triangles(const rt::scene& scene, const ray r) noexcept
+{
+	ray_hits hits;
+	find_triangles(scene, r, ray_batch{ r }, hits);
+	return resolve_hit(scene, r, hits);
+}
+
+hit_result MUU_VECTORCALL rt::test_instances(const rt::scene& scene, const ray r) noexcept
+{
+	ray_hits hits;
+	find_instances(scene, r, hits);
+	return resolve_hit(scene, r, hits);
+}
+
+namespace
+{
+	// rays are tallied in a plain thread-local and only added to the shared total when a tile finishes (see
+	// flush_ray_count()), so the per-ray cost is a single add with no locking, atomics or thread_local init guard.
+	MUU_DISABLE_WARNINGS;
+	static constinit thread_local uint64_t pending_ray_count = 0;
+	static constinit std::atomic_uint64_t total_ray_count{};
+	MUU_ENABLE_WARNINGS;
+
+	MUU_ALWAYS_INLINE
+	static void count_rays(uint64_t count) noexcept
+	{
+		pending_ray_count += count;
+	}
+}
+
+void rt::add_traced_rays(uint64_t count) noexcept
+{
+	count_rays(count);
+}
+
+void rt::flush_ray_count() noexcept
+{
+	if (pending_ray_count)
+	{
+		total_ray_count.fetch_add(pending_ray_count, std::memory_order_relaxed);
+		pending_ray_count = 0;
+	}
+}
+
+uint64_t rt::rays_traced() noexcept
+{
+	return total_ray_count.load(std::memory_order_relaxed);
+}
+
+hit_result MUU_VECTORCALL rt::closest_hit(const rt::scene& scene, const ray r) noexcept
+{
+	count_rays(1u);
+
+	// planes go first since there are few of them and they're usually big (e.g. the ground),
+	// so they tend to give the bvh traversals after them a short max distance to start with
+	const auto rb = ray_batch{ r };
+	ray_hits hits;
+	find_planes(scene, rb, hits);
+	find_primitives(scene, r, rb, hits);
+	find_triangles(scene, r, rb, hits);
+	find_instances(scene, r, hits);
+	return resolve_hit(scene, r, hits);
+}
+
+bool MUU_VECTORCALL rt::occluded(const rt::scene& scene, const ray r, float t_max) noexcept
+{
+	count_rays(1u);
+
+	// same order as closest_hit(), but each structure only needs searching if the ones before it found nothing
+	const auto rb = ray_batch{ r };
+	ray_hits hits;
+	hits.dist = t_max;
+	find_planes(scene, rb, hits);
+	if (hits.kind == primitive_kind::none)
+		find_primitives<true>(scene, r, rb, hits);
+	if (hits.kind == primitive_kind::none)
+		find_triangles<true>(scene, r, rb, hits);
+	if (hits.kind == primitive_kind::none)
+		find_instances<true>(scene, r, hits);
+	return hits.kind != primitive_kind::none;
+}
+
+namespace
+{
+	// per-lane closest hits for a ray packet
+	struct packet_hits
+	{
+		batch dist = batch{ floats::highest };
+		primitive_kind kinds[packet_size]{};
+		size_t indices[packet_size]{};
+		size_t instances[packet_size]{}; // only meaningful for primitive_kind::instance
+
+		MUU_ALWAYS_INLINE
+		void MUU_VECTORCALL record(batch_bool closer, batch t, primitive_kind kind, size_t index) noexcept
+		{
+			dist = xsimd::select(closer, t, dist);
+			for (auto bits = closer.mask(); bits; bits &= bits - 1u)
+			{
+				const auto lane = static_cast<size_t>(std::countr_zero(bits));
+				kinds[lane]		= kind;
+				indices[lane]	= index;
+			}
+		}
+	};
+
+	struct packet_inverse_direction
+	{
+		batch x, y, z;
+
+		MUU_NODISCARD_CTOR
+		explicit packet_inverse_direction(const ray_packet& r) noexcept
+			: x{ safe_reciprocal(r.dir_x) },
+			  y{ safe_reciprocal(r.dir_y) },
+			  z{ safe_reciprocal(r.dir_z) }
+		{}
+
+	  private:
+		MUU_PURE_INLINE_GETTER
+		static batch MUU_VECTORCALL safe_reciprocal(batch f) noexcept
+		{
+			const auto tiny = xsimd::select(f < batch{ 0.0f }, batch{ -1e-8f }, batch{ 1e-8f });
+			return batch{ 1.0f } / xsimd::select(xsimd::abs(f) < batch{ 1e-8f }, tiny, f);
+		}
+	};
+
+	MUU_PURE_GETTER
+	static batch_bool MUU_VECTORCALL lanes_from_bits(uint32_t bits) noexcept
+	{
+		alignas(64) float flags[packet_size];
+		for (size_t i = 0; i < packet_size; i++)
+			flags[i] = (bits >> i) & 1u ? 1.0f : 0.0f;
+		return xsimd::load_aligned(flags) > batch{ 0.5f };
+	}
+
+	MUU_ALWAYS_INLINE
+	static void MUU_VECTORCALL intersect_planes(const rt::planes& planes,
+												const ray_packet& r,
+												batch_bool live,
+												packet_hits& hits) noexcept
+	{
+		for (size_t i = 0, e = planes.size(); i < e; i++)
+		{
+			const auto n_x = batch{ planes.normal_x()[i] };
+			const auto n_y = batch{ planes.normal_y()[i] };
+			const auto n_z = batch{ planes.normal_z()[i] };
+
+			const auto denom = n_x * r.dir_x + n_y * r.dir_y + n_z * r.dir_z;
+			const auto dist	 = n_x * r.origin_x + n_y * r.origin_y + n_z * r.origin_z + batch{ planes.d()[i] };
+
+			auto valid	 = live & (xsimd::abs(denom) > batch{ 1e-6f });
+			const auto t = -dist / xsimd::select(valid, denom, batch{ 1.0f });
+
+			valid = valid & (t >= batch{ min_hit_dist }) & (t < hits.dist);
+			if (xsimd::any(valid))
+				hits.record(valid, t, primitive_kind::plane, i);
+		}
+	}
+
+	MUU_ALWAYS_INLINE
+	static void MUU_VECTORCALL intersect_sphere(const rt::spheres& spheres,
+												size_t i,
+												const ray_packet& r,
+												batch dir_length_sq,
+												batch_bool live,
+												packet_hits& hits) noexcept
+	{
+		const auto oc_x = r.origin_x - batch{ spheres.center_x()[i] };
+		const auto oc_y = r.origin_y - batch{ spheres.center_y()[i] };
+		const auto oc_z = r.origin_z - batch{ spheres.center_z()[i] };
+		const auto rad	= spheres.radius()[i];
+
+		const auto b	= oc_x * r.dir_x + oc_y * r.dir_y + oc_z * r.dir_z;
+		const auto c	= oc_x * oc_x + oc_y * oc_y + oc_z * oc_z - batch{ rad * rad };
+		const auto disc = b * b - dir_length_sq * c;
+
+		auto valid = live & (disc >= batch{ 0.0f });
+		if (xsimd::none(valid))
+			return;
+
+		const auto root = xsimd::sqrt(xsimd::max(disc, batch{ 0.0f }));
+		const auto t0	= (-b - root) / dir_length_sq;
+		const auto t1	= (-b + root) / dir_length_sq;
+		const auto t	= xsimd::select(t0 >= batch{ min_hit_dist }, t0, t1);
+
+		valid = valid & (t >= batch{ min_hit_dist }) & (t < hits.dist);
+		if (xsimd::any(valid))
+			hits.record(valid, t, primitive_kind::sphere, i);
+	}
+
+	MUU_ALWAYS_INLINE
+	static batch_bool MUU_VECTORCALL packet_slab_test(const bvh_node& node,
+													  const ray_packet& r,
+													  const packet_inverse_direction& inv,
+													  batch max_dist) noexcept
+	{
+		const auto t0_x = (batch{ node.min.x } - r.origin_x) * inv.x;
+		const auto t1_x = (batch{ node.max.x } - r.origin_x) * inv.x;
+		const auto t0_y = (batch{ node.min.y } - r.origin_y) * inv.y;
+		const auto t1_y = (batch{ node.max.y } - r.origin_y) * inv.y;
+		const auto t0_z = (batch{ node.min.z } - r.origin_z) * inv.z;
+		const auto t1_z = (batch{ node.max.z } - r.origin_z) * inv.z;
+
+		const auto entry = xsimd::max(xsimd::max(xsimd::min(t0_x, t1_x), xsimd::min(t0_y, t1_y)),
+									  xsimd::max(xsimd::min(t0_z, t1_z), batch{ 0.0f }));
+		const auto exit	 = xsimd::min(xsimd::min(xsimd::max(t0_x, t1_x), xsimd::max(t0_y, t1_y)),
+									  xsimd::min(xsimd::max(t0_z, t1_z), max_dist));
+		return entry <= exit;
+	}
+
+	// calls leaf_func(first, count, lanes) for every leaf at least one live ray passes through, where lanes are the
+	// rays that do. leaf_func is expected to shrink hits.dist as it finds closer hits.
+	template <typename Func>
+	MUU_ALWAYS_INLINE
+	static void MUU_VECTORCALL traverse_packet(const rt::bvh& bvh,
+											   const ray_packet& r,
+											   const packet_inverse_direction& inv,
+											   batch_bool live,
+											   const packet_hits& hits,
+											   Func&& leaf_func) noexcept
+	{
+		const auto nodes = bvh.nodes();
+		if (nodes.empty())
+			return;
+
+		// children are visited nearest-first according to the packet's average ray
+		const auto mean_origin = vec3{ xsimd::reduce_add(r.origin_x),
+									   xsimd::reduce_add(r.origin_y),
+									   xsimd::reduce_add(r.origin_z) }
+							   / static_cast<float>(packet_size);
+		const auto mean_dir =
+			vec3{ xsimd::reduce_add(r.dir_x), xsimd::reduce_add(r.dir_y), xsimd::reduce_add(r.dir_z) };
+		const auto distance_along = [&](const bvh_node& node) noexcept
+		{ return vec3::dot((node.min + node.max) * 0.5f - mean_origin, mean_dir); };
+
+		uint32_t stack[bvh::max_depth * 2u];
+		uint32_t stack_size	 = 0;
+		stack[stack_size++] = 0;
+
+		while (stack_size)
+		{
+			const auto& node = nodes[stack[--stack_size]];
+			const auto hit	 = live & packet_slab_test(node, r, inv, hits.dist);
+			if (xsimd::none(hit))
+				continue;
+
+			if (node.count)
+			{
+				leaf_func(node.index, node.count, hit);
+				continue;
+			}
+
+			auto near_ = static_cast<uint32_t>(&node - nodes.data()) + 1u;
+			auto far_  = node.index;
+			if (distance_along(nodes[far_]) < distance_along(nodes[near_]))
+				std::swap(near_, far_);
+
+			assert(stack_size + 2u <= std::size(stack));
+			stack[stack_size++] = far_;
+			stack[stack_size++] = near_;
+		}
+	}
+
+	MUU_ALWAYS_INLINE
+	static void MUU_VECTORCALL intersect_box(const rt::boxes& boxes,
+											 size_t i,
+											 const ray_packet& r,
+											 const packet_inverse_direction& inv,
+											 batch_bool live,
+											 packet_hits& hits) noexcept
+	{
+		const auto slab =
+			[](float center, float extents, batch origin, batch inv_dir, batch& near_, batch& far_) noexcept
+		{
+			const auto t0 = (batch{ center - extents } - origin) * inv_dir;
+			const auto t1 = (batch{ center + extents } - origin) * inv_dir;
+			near_		  = xsimd::min(t0, t1);
+			far_		  = xsimd::max(t0, t1);
+		};
+
+		batch near_x, far_x, near_y, far_y, near_z, far_z;
+		slab(boxes.center_x()[i], boxes.extents_x()[i], r.origin_x, inv.x, near_x, far_x);
+		slab(boxes.center_y()[i], boxes.extents_y()[i], r.origin_y, inv.y, near_y, far_y);
+		slab(boxes.center_z()[i], boxes.extents_z()[i], r.origin_z, inv.z, near_z, far_z);
+
+		const auto t_near = xsimd::max(xsimd::max(near_x, near_y), near_z);
+		const auto t_far  = xsimd::min(xsimd::min(far_x, far_y), far_z);
+		const auto t	  = xsimd::select(t_near >= batch{ min_hit_dist }, t_near, t_far);
+
+		const auto valid = live & (t_near <= t_far) & (t >= batch{ min_hit_dist }) & (t < hits.dist);
+		if (xsimd::any(valid))
+			hits.record(valid, t, primitive_kind::box, i);
+	}
+
+	MUU_ALWAYS_INLINE
+	static void MUU_VECTORCALL intersect_primitives(const rt::scene& scene,
+													const ray_packet& r,
+													const packet_inverse_direction& inv,
+													batch_bool live,
+													packet_hits& hits) noexcept
+	{
+		const auto dir_length_sq = r.dir_x * r.dir_x + r.dir_y * r.dir_y + r.dir_z * r.dir_z;
+
+		traverse_packet(scene.primitive_bvh,
+						r,
+						inv,
+						live,
+						hits,
+						[&](uint32_t first, uint32_t count, batch_bool lanes) noexcept
+						{
+							const auto leaf = leaf_ranges{ scene, first, count };
+							for (size_t i = leaf.sphere_first, e = i + leaf.sphere_count; i < e; i++)
+								intersect_sphere(scene.spheres, i, r, dir_length_sq, lanes, hits);
+							for (size_t i = leaf.box_first, e = i + leaf.box_count; i < e; i++)
+								intersect_box(scene.boxes, i, r, inv, lanes, hits);
+						});
+	}
+
+	MUU_ALWAYS_INLINE
+	static void MUU_VECTORCALL intersect_triangle(const rt::triangles& triangles,
+												  size_t i,
+												  const ray_packet& r,
+												  batch_bool live,
+												  packet_hits& hits) noexcept
+	{
+		const auto e1_x = batch{ triangles.e1_x()[i] };
+		const auto e1_y = batch{ triangles.e1_y()[i] };
+		const auto e1_z = batch{ triangles.e1_z()[i] };
+		const auto e2_x = batch{ triangles.e2_x()[i] };
+		const auto e2_y = batch{ triangles.e2_y()[i] };
+		const auto e2_z = batch{ triangles.e2_z()[i] };
+
+		const auto p_x = r.dir_y * e2_z - r.dir_z * e2_y;
+		const auto p_y = r.dir_z * e2_x - r.dir_x * e2_z;
+		const auto p_z = r.dir_x * e2_y - r.dir_y * e2_x;
+		const auto det = e1_x * p_x + e1_y * p_y + e1_z * p_z;
+
+		auto valid		   = live & (xsimd::abs(det) > batch{ 1e-12f });
+		const auto inv_det = batch{ 1.0f } / xsimd::select(valid, det, batch{ 1.0f });
+
+		const auto o_x = r.origin_x - batch{ triangles.v0_x()[i] };
+		const auto o_y = r.origin_y - batch{ triangles.v0_y()[i] };
+		const auto o_z = r.origin_z - batch{ triangles.v0_z()[i] };
+
+		const auto u = (o_x * p_x + o_y * p_y + o_z * p_z) * inv_det;
+		valid		 = valid & (u >= batch{ 0.0f }) & (u <= batch{ 1.0f });
+		if (xsimd::none(valid))
+			return;
+
+		const auto q_x = o_y * e1_z - o_z * e1_y;
+		const auto q_y = o_z * e1_x - o_x * e1_z;
+		const auto q_z = o_x * e1_y - o_y * e1_x;
+		const auto v   = (r.dir_x * q_x + r.dir_y * q_y + r.dir_z * q_z) * inv_det;
+		const auto t   = (e2_x * q_x + e2_y * q_y + e2_z * q_z) * inv_det;
+
+		valid = valid & (v >= batch{ 0.0f }) & (u + v <= batch{ 1.0f }) & (t >= batch{ min_hit_dist })
+			  & (t < hits.dist);
+		if (xsimd::any(valid))
+			hits.record(valid, t, primitive_kind::triangle, i);
+	}
+
+	MUU_ALWAYS_INLINE
+	static void MUU_VECTORCALL intersect_triangles(const rt::scene& scene,
+												   const ray_packet& r,
+												   const packet_inverse_direction& inv,
+												   batch_bool live,
+												   packet_hits& hits) noexcept
+	{
+		for (const auto& mesh : scene.meshes)
+		{
+			traverse_packet(mesh.bvh,
+							r,
+							inv,
+							live,
+							hits,
+							[&](uint32_t first, uint32_t count, batch_bool lanes) noexcept
+							{
+								for (size_t i = mesh.first + first, e = i + count; i < e; i++)
+									intersect_triangle(scene.triangles, i, r, lanes, hits);
+							});
+		}
+	}
+
+	MUU_ALWAYS_INLINE
+	static ray_packet MUU_VECTORCALL to_object_space(const instance& inst, const ray_packet& r) noexcept
+	{
+		const auto& m	= inst.to_object;
+		const auto o_x = r.origin_x - batch{ inst.position.x };
+		const auto o_y = r.origin_y - batch{ inst.position.y };
+		const auto o_z = r.origin_z - batch{ inst.position.z };
+
+		auto local	   = r;
+		local.origin_x = batch{ m(0, 0) } * o_x + batch{ m(0, 1) } * o_y + batch{ m(0, 2) } * o_z;
+		local.origin_y = batch{ m(1, 0) } * o_x + batch{ m(1, 1) } * o_y + batch{ m(1, 2) } * o_z;
+		local.origin_z = batch{ m(2, 0) } * o_x + batch{ m(2, 1) } * o_y + batch{ m(2, 2) } * o_z;
+		local.dir_x	   = batch{ m(0, 0) } * r.dir_x + batch{ m(0, 1) } * r.dir_y + batch{ m(0, 2) } * r.dir_z;
+		local.dir_y	   = batch{ m(1, 0) } * r.dir_x + batch{ m(1, 1) } * r.dir_y + batch{ m(1, 2) } * r.dir_z;
+		local.dir_z	   = batch{ m(2, 0) } * r.dir_x + batch{ m(2, 1) } * r.dir_y + batch{ m(2, 2) } * r.dir_z;
+		return local;
+	}
+
+	MUU_ALWAYS_INLINE
+	static void MUU_VECTORCALL intersect_instances(const rt::scene& scene,
+												   const ray_packet& r,
+												   const packet_inverse_direction& inv,
+												   batch_bool live,
+												   packet_hits& hits) noexcept
+	{
+		traverse_packet(
+			scene.instance_bvh,
+			r,
+			inv,
+			live,
+			hits,
+			[&](uint32_t first, uint32_t count, batch_bool lanes) noexcept
+			{
+				for (size_t i = first, e = first + count; i < e; i++)
+				{
+					const auto& inst   = scene.instances[i];
+					const auto& object = scene.objects[inst.object];
+					const auto local   = to_object_space(inst, r);
+					const auto prev	   = hits.dist;
+
+					traverse_packet(object.bvh,
+									local,
+									packet_inverse_direction{ local },
+									lanes,
+									hits,
+									[&](uint32_t obj_first, uint32_t obj_count, batch_bool obj_lanes) noexcept
+									{
+										for (size_t j = object.first + obj_first, f = j + obj_count; j < f; j++)
+											intersect_triangle(scene.triangles, j, local, obj_lanes, hits);
+									});
+
+					// the triangle kernel recorded these as plain triangles; they need to know whose they were
+					for (auto bits = (hits.dist < prev).mask(); bits; bits &= bits - 1u)
+					{
+						const auto lane		 = static_cast<size_t>(std::countr_zero(bits));
+						hits.kinds[lane]	 = primitive_kind::instance;
+						hits.instances[lane] = i;
+					}
+				}
+			});
+	}
+}
+
+void MUU_VECTORCALL rt::test_packet(const rt::scene& scene,
+									const ray_packet& rays,
+									uint32_t active_lanes,
+									hit_result (&hits)[packet_size]) noexcept
+{
+	MUU_FMA_BLOCK;
+
+	count_rays(static_cast<uint64_t>(std::popcount(active_lanes)));
+
+	const auto live = lanes_from_bits(active_lanes);
+	const auto inv	= packet_inverse_direction{ rays };
+
+	packet_hits closest;
+	intersect_planes(scene.planes, rays, live, closest);
+	intersect_primitives(scene, rays, inv, live, closest);
+	intersect_triangles(scene, rays, inv, live, closest);
+	intersect_instances(scene, rays, inv, live, closest);
+
+	alignas(64) float values[7][packet_size];
+	closest.dist.store_aligned(values[0]);
+	rays.origin_x.store_aligned(values[1]);
+	rays.origin_y.store_aligned(values[2]);
+	rays.origin_z.store_aligned(values[3]);
+	rays.dir_x.store_aligned(values[4]);
+	rays.dir_y.store_aligned(values[5]);
+	rays.dir_z.store_aligned(values[6]);
+
+	for (size_t lane = 0; lane < packet_size; lane++)
+	{
+		const auto dist	 = values[0][lane];
+		const auto point = vec3{ values[1][lane], values[2][lane], values[3][lane] }
+						 + vec3{ values[4][lane], values[5][lane], values[6][lane] } * dist;
+
+		hits[lane] =
+			resolve_hit(scene, closest.kinds[lane], closest.indices[lane], closest.instances[lane], dist, point);
+	}
+}
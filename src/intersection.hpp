@@ -0,0 +1,117 @@
+#pragma once
+#include "common.hpp"
+MUU_DISABLE_WARNINGS;
+#include <xsimd/xsimd.hpp>
+MUU_ENABLE_WARNINGS;
+
+namespace rt
+{
+	inline constexpr float min_hit_dist = 0.001f;
+
+	// the simd kernels always load full batches, so scene tables keep this many zeroed rows past their end
+	inline constexpr size_t simd_padding = 16;
+
+	struct hit_result
+	{
+		float distance;
+		vec3 normal;
+		unsigned material;
+
+		MUU_PURE_INLINE_GETTER
+		explicit constexpr operator bool() const noexcept
+		{
+			return distance >= 0.0f;
+		}
+	};
+
+	// the normal flipped to the side of the surface a ray arrived from, if need be.
+	// triangles are hit from both sides and rays can start inside boxes, so hit_result::normal may face away.
+	MUU_PURE_INLINE_GETTER
+	constexpr vec3 MUU_VECTORCALL face_forward(const vec3& normal, const vec3& direction) noexcept
+	{
+		return vec3::dot(normal, direction) > 0.0f ? -normal : normal;
+	}
+
+	using simd_float = xsimd::batch<float>;
+
+	// one ray per simd lane (i.e. 8 on AVX2)
+	inline constexpr size_t packet_size = simd_float::size;
+
+	struct ray_packet
+	{
+		simd_float origin_x, origin_y, origin_z;
+		simd_float dir_x, dir_y, dir_z;
+
+		MUU_NODISCARD_CTOR
+		explicit ray_packet(const ray (&rays)[packet_size]) noexcept
+		{
+			alignas(64) float values[6][packet_size];
+			for (size_t i = 0; i < packet_size; i++)
+			{
+				values[0][i] = rays[i].origin.x;
+				values[1][i] = rays[i].origin.y;
+				values[2][i] = rays[i].origin.z;
+				values[3][i] = rays[i].direction.x;
+				values[4][i] = rays[i].direction.y;
+				values[5][i] = rays[i].direction.z;
+			}
+			origin_x = xsimd::load_aligned(values[0]);
+			origin_y = xsimd::load_aligned(values[1]);
+			origin_z = xsimd::load_aligned(values[2]);
+			dir_x	 = xsimd::load_aligned(values[3]);
+			dir_y	 = xsimd::load_aligned(values[4]);
+			dir_z	 = xsimd::load_aligned(values[5]);
+		}
+	};
+
+	MUU_PURE_INLINE_GETTER
+	constexpr hit_result select(const hit_result& a, const hit_result& b) noexcept
+	{
+		if (!a)
+			return b;
+
+		return !b || a.distance <= b.distance ? a : b;
+	}
+
+	MUU_PURE_GETTER
+	hit_result MUU_VECTORCALL test_planes(const scene& scene, const ray r) noexcept;
+
+	// spheres and boxes, which share one bvh
+	MUU_PURE_GETTER
+	hit_result MUU_VECTORCALL test_primitives(const scene& scene, const ray r) noexcept;
+
+	MUU_PURE_GETTER
+	hit_result MUU_VECTORCALL test_triangles(const scene& scene, const ray r) noexcept;
+
+	MUU_PURE_GETTER
+	hit_result MUU_VECTORCALL test_instances(const scene& scene, const ray r) noexcept;
+
+	// closest hit against planes, spheres, boxes, triangles and instances.
+	// each acceleration structure starts from the closest hit found by the ones before it.
+	hit_result MUU_VECTORCALL closest_hit(const scene& scene, const ray r) noexcept;
+
+	// is anything in the way between the ray's origin and t_max along it (e.g. for shadow or ambient occlusion rays)?
+	// stops at the first hit found rather than searching for the closest, so it's cheaper than closest_hit().
+	MUU_NODISCARD
+	bool MUU_VECTORCALL occluded(const scene& scene, const ray r, float t_max) noexcept;
+
+	// closest hit against planes, spheres, boxes, triangles and instances for every lane whose bit is set in active_lanes.
+	// inactive lanes are reported as misses.
+	void MUU_VECTORCALL test_packet(const scene& scene,
+									const ray_packet& rays,
+									uint32_t active_lanes,
+									hit_result (&hits)[packet_size]) noexcept;
+
+	// counts rays a renderer traced some other way than closest_hit(), occluded() or test_packet() (e.g. through the
+	// test_xxx() functions above, which don't count anything themselves).
+	void add_traced_rays(uint64_t count) noexcept;
+
+	// adds the rays the calling thread has traced since its last flush to the total reported by rays_traced().
+	// tile_scheduler calls this after every tile, so renderers only need to for rays traced outside of one.
+	void flush_ray_count() noexcept;
+
+	// the number of rays traced through closest_hit(), occluded() and test_packet() (or added by add_traced_rays())
+	// so far, summed across all threads (as of their last flush_ray_count())
+	MUU_NODISCARD
+	uint64_t rays_traced() noexcept;
+}
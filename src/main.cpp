@@ -3,6 +3,8 @@
 #include "image.hpp"
 #include "scene.hpp"
 #include "renderer.hpp"
+#include "image_file.hpp"
+#include "intersection.hpp"
 
 MUU_DISABLE_WARNINGS;
 #include <memory>
@@ -11,9 +13,15 @@ MUU_DISABLE_WARNINGS;
 #include <iostream>
 #include <numeric>
 #include <exception>
+#include <stdexcept>
 #include <SDL_main.h>
 #include <atomic>
 #include <span>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <utility>
+#include <algorithm>
 #include <muu/thread_pool.h>
 #include <muu/strings.h>
 #include <argparse/argparse.hpp>
@@ -49,7 +57,7 @@ namespace
 	struct renderer
 	{
 		const renderers::description* description;
-		std::unique_ptr<renderer_interface> object;
+		std::shared_ptr<renderer_interface> object; // shared with in-flight render jobs
 
 		MUU_PURE_INLINE_GETTER
 		explicit operator bool() const noexcept
@@ -80,6 +88,248 @@ namespace
 		return {};
 	}
 
+	MUU_NODISCARD
+	static rt::scene load_scene(const argparse::ArgumentParser& args, const rt::scene* previous = nullptr)
+	{
+		const auto path = muu::trim(args.get<std::string>("scene"));
+
+		auto s = path.empty() ? scene::load_first_available(previous) : scene::load(path, previous);
+		if (const auto seed = args.present<uint64_t>("seed"))
+			s.seed = *seed;
+		return s;
+	}
+
+	// renders a single image without creating a window (so SDL and ImGui are never initialized)
+	static void run_headless(const argparse::ArgumentParser& args)
+	{
+		const auto name = muu::trim(args.get<std::string>("renderer"));
+		const auto desc = find_renderer_by_name_fuzzy(name);
+		if (!desc)
+			throw std::runtime_error{ "no known renderer with name '"s + std::string(name) + "'"s };
+
+		const auto scene = load_scene(args);
+		log("scene '"sv, scene.path, "' loaded."sv);
+
+		const auto size = vec2u{ args.get<unsigned>("width"), args.get<unsigned>("height") };
+		auto img		= image{ size };
+		auto pixels		= image_view{ img };
+		pixels.clear(colours::black);
+
+		muu::thread_pool threads;
+		auto r = std::unique_ptr<renderer_interface>{ desc->create() };
+
+		// progressive renderers need to be called until they've accumulated all their samples
+		const auto settings = scene.settings();
+		const auto start	= clock::now();
+		do
+		{
+			render_control control;
+			r->render(scene, settings, pixels, threads, control);
+		}
+		while (!r->converged());
+
+		const auto elapsed = to_seconds(clock::now() - start);
+		log("rendered "sv, size.x, "x"sv, size.y, " with "sv, desc->name, " in "sv, elapsed, "s"sv);
+
+		if (const auto output = args.present<std::string>("output"))
+		{
+			std::vector<vec3> linear(size_t{ size.x } * size.y);
+			if (!r->linear_image(linear))
+				linear.clear();
+			save_image(pixels, *output, linear);
+			log("wrote "sv, *output);
+		}
+	}
+
+	MUU_NODISCARD
+	static std::string json_string(std::string_view str)
+	{
+		std::string out{ "\"" };
+		for (auto c : str)
+		{
+			if (c == '"' || c == '\\')
+				out += '\\';
+			out += c;
+		}
+		out += '"';
+		return out;
+	}
+
+	// renderers that only exist to produce another renderer's image faster, paired with the one they should beat.
+	// the bench reports how they compare so that claim is measured rather than assumed.
+	static constexpr std::pair<std::string_view, std::string_view> bench_comparisons[] = {
+		{ "mg_packet_tracer"sv, "mg_ray_tracer"sv },
+	};
+
+	// renders every registered renderer over each scene at a few resolutions and thread counts,
+	// then prints the timings to stdout as JSON. progress goes to stderr.
+	static void run_bench(const argparse::ArgumentParser& args)
+	{
+		struct bench_result
+		{
+			std::string scene;
+			std::string_view renderer;
+			vec2u size;
+			unsigned threads;
+			double ms_per_frame;
+			double rays_per_sec;
+		};
+		std::vector<bench_result> results;
+
+		static constexpr vec2u resolutions[] = { { 320u, 240u }, { 640u, 480u }, { 1280u, 720u } };
+		const auto frames					 = std::max(args.get<unsigned>("bench-frames"), 1u);
+
+		std::vector<std::string> scene_paths;
+		if (const auto path = muu::trim(args.get<std::string>("scene")); !path.empty())
+			scene_paths.emplace_back(path);
+		else
+			scene_paths = scene::find_all();
+		if (scene_paths.empty())
+			throw std::runtime_error{ "no scene files found" };
+
+		const auto hardware_threads = std::max(std::thread::hardware_concurrency(), 1u);
+		std::vector<unsigned> thread_counts{ 1u };
+		if (hardware_threads / 2u > 1u)
+			thread_counts.push_back(hardware_threads / 2u);
+		if (hardware_threads > 1u)
+			thread_counts.push_back(hardware_threads);
+
+		std::ostringstream json;
+		json << "{\n\t\"frames\": "sv << frames << ",\n\t\"results\": ["sv;
+		bool first_result = true;
+
+		for (const auto& path : scene_paths)
+		{
+			auto scene = rt::scene::load(path);
+			if (const auto seed = args.present<uint64_t>("seed"))
+				scene.seed = *seed;
+			const auto settings = scene.settings();
+
+			for (const auto thread_count : thread_counts)
+			{
+				muu::thread_pool threads{ size_t{ thread_count } };
+
+				for (const auto& desc : renderers::all())
+				{
+					auto r = std::unique_ptr<renderer_interface>{ desc.create() };
+
+					for (const auto size : resolutions)
+					{
+						print(std::cerr,
+							  "bench: "sv,
+							  scene.path,
+							  ", "sv,
+							  desc.name,
+							  ", "sv,
+							  size.x,
+							  "x"sv,
+							  size.y,
+							  ", "sv,
+							  thread_count,
+							  " threads"sv);
+
+						auto img	= image{ size };
+						auto pixels = image_view{ img };
+
+						const auto render_frame = [&]()
+						{
+							r->reset();
+							do
+							{
+								render_control control;
+								r->render(scene, settings, pixels, threads, control);
+							}
+							while (!r->converged());
+						};
+						render_frame(); // warm-up
+
+						std::vector<double> frame_ms;
+						uint64_t rays = 0;
+						for (unsigned i = 0; i < frames; i++)
+						{
+							const auto rays_before = rays_traced();
+							const auto start	   = clock::now();
+							render_frame();
+							frame_ms.push_back(static_cast<double>(to_seconds(clock::now() - start)) * 1000.0);
+							rays += rays_traced() - rays_before;
+						}
+
+						const auto total_ms = std::accumulate(frame_ms.begin(), frame_ms.end(), 0.0);
+						const auto mean_ms	= total_ms / static_cast<double>(frames);
+						double variance		= 0.0;
+						for (const auto ms : frame_ms)
+							variance += (ms - mean_ms) * (ms - mean_ms);
+						if (frames > 1u)
+							variance /= static_cast<double>(frames - 1u);
+
+						// renderers don't report how many samples they actually took, so with adaptive sampling this is
+						// an upper bound (every pixel taking the maximum). rays_per_sec is always measured.
+						const auto seconds = std::max(total_ms / 1000.0, 1e-9);
+						const auto samples = static_cast<double>(size.x) * static_cast<double>(size.y)
+										   * static_cast<double>(settings.max_samples_per_pixel())
+										   * static_cast<double>(frames);
+
+						json << (first_result ? "\n"sv : ",\n"sv) << "\t\t{ "sv;
+						json << "\"scene\": "sv << json_string(scene.path) << ", "sv;
+						json << "\"renderer\": "sv << json_string(desc.name) << ", "sv;
+						json << "\"width\": "sv << size.x << ", \"height\": "sv << size.y << ", "sv;
+						json << "\"threads\": "sv << thread_count << ", "sv;
+						json << "\"samples_per_pixel\": "sv << settings.samples_per_pixel << ", "sv;
+						json << "\"max_samples_per_pixel\": "sv << settings.max_samples_per_pixel() << ", "sv;
+						json << "\"adaptive\": "sv << (settings.adaptive ? "true"sv : "false"sv) << ", "sv;
+						json << "\"ms_per_frame\": "sv << mean_ms << ", "sv;
+						json << "\"ms_variance\": "sv << variance << ", "sv;
+						json << "\"ms_min\": "sv << *std::min_element(frame_ms.begin(), frame_ms.end()) << ", "sv;
+						json << "\"ms_max\": "sv << *std::max_element(frame_ms.begin(), frame_ms.end()) << ", "sv;
+						json << "\"nominal_samples_per_sec\": "sv << samples / seconds << ", "sv;
+						json << "\"rays_per_sec\": "sv << static_cast<double>(rays) / seconds << " }"sv;
+						first_result = false;
+
+						results.push_back({ .scene		  = scene.path,
+											.renderer	  = desc.name,
+											.size		  = size,
+											.threads	  = thread_count,
+											.ms_per_frame = mean_ms,
+											.rays_per_sec = static_cast<double>(rays) / seconds });
+					}
+				}
+			}
+		}
+
+		json << "\n\t],\n\t\"comparisons\": ["sv;
+		bool first_comparison = true;
+		for (const auto& [name, baseline_name] : bench_comparisons)
+		{
+			for (const auto& res : results)
+			{
+				if (res.renderer != name)
+					continue;
+
+				const bench_result* baseline = nullptr;
+				for (const auto& other : results)
+					if (other.renderer == baseline_name && other.scene == res.scene && other.size == res.size
+						&& other.threads == res.threads)
+						baseline = &other;
+				if (!baseline)
+					continue;
+
+				json << (first_comparison ? "\n"sv : ",\n"sv) << "\t\t{ "sv;
+				json << "\"scene\": "sv << json_string(res.scene) << ", "sv;
+				json << "\"renderer\": "sv << json_string(res.renderer) << ", "sv;
+				json << "\"baseline\": "sv << json_string(baseline->renderer) << ", "sv;
+				json << "\"width\": "sv << res.size.x << ", \"height\": "sv << res.size.y << ", "sv;
+				json << "\"threads\": "sv << res.threads << ", "sv;
+				json << "\"speedup\": "sv << baseline->ms_per_frame / std::max(res.ms_per_frame, 1e-9) << ", "sv;
+				json << "\"rays_per_sec_ratio\": "sv << res.rays_per_sec / std::max(baseline->rays_per_sec, 1e-9)
+					 << " }"sv;
+				first_comparison = false;
+			}
+		}
+
+		json << "\n\t]\n}\n"sv;
+		std::cout << json.str();
+	}
+
 	static void run(const argparse::ArgumentParser& args)
 	{
 		bool renderer_changed	   = false;
@@ -103,26 +353,27 @@ namespace
 		};
 
 		renderer regular_renderer = create_renderer(muu::trim(args.get<std::string>("renderer")));
-		renderer low_res_renderer = create_renderer("rasterizer"sv);
-		rt::scene scene;
+
+		// the scene is shared with the render thread and never modified once loaded. the ui thread's camera and the
+		// (possibly scaled-down) sample counts go to each frame as frame_settings instead.
+		// reloading swaps in a new scene rather than modifying the one a frame might be using.
+		std::shared_ptr<const rt::scene> scene = std::make_shared<rt::scene>();
+		rt::camera camera;
+		bool reset_pending = false;
+
 		time_point last_scene_write_check{};
 		fs::file_time_type last_scene_write{};
-		const auto reload_scene = [&](bool preserve_camera = true)
+		bool scene_content_changed = false;
+		const auto reload_scene	   = [&](bool preserve_camera = true)
 		{
-			const auto prev_camera = scene.camera;
-			const auto do_cam	   = muu::scope_guard{ [&]() noexcept
-												   {
-													  if (preserve_camera)
-														  scene.camera = prev_camera;
-												  } };
-
 			try
 			{
-				const auto path = muu::trim(args.get<std::string>("scene"));
-				if (path.empty())
-					scene = scene::load_first_available();
-				else
-					scene = scene::load(path);
+				// the previous scene is only used as a source of things that don't need rebuilding
+				auto loaded			  = load_scene(args, preserve_camera ? scene.get() : nullptr);
+				scene_content_changed = !preserve_camera || loaded.content_hash != scene->content_hash;
+				scene				  = std::make_shared<rt::scene>(std::move(loaded));
+				if (!preserve_camera)
+					camera = scene->camera;
 			}
 			catch (const std::exception& ex)
 			{
@@ -132,17 +383,17 @@ namespace
 			}
 
 			last_scene_write_check = clock::now();
-			if (!scene.path.empty())
+			if (!scene->path.empty())
 			{
 				try
 				{
-					last_scene_write = fs::last_write_time(scene.path);
+					last_scene_write = fs::last_write_time(scene->path);
 				}
 				catch (...)
 				{
 					last_scene_write = {};
 				}
-				log("scene '"sv, scene.path, "' loaded."sv);
+				log("scene '"sv, scene->path, "' loaded."sv);
 			}
 			else
 				log("scene loaded."sv);
@@ -151,12 +402,14 @@ namespace
 		};
 
 		auto win				= window{ "rt"s, { 800, 600 } };
+		win.scaling.budget		= args.get<float>("frame-budget") / 1000.0f;
+		win.wait_for_events		= !args.get<bool>("continuous");
 		const auto update_title = [&]()
 		{
 			std::ostringstream ss;
 			ss << "rt"sv;
-			if (!scene.path.empty())
-				ss << " - "sv << scene.path;
+			if (!scene->path.empty())
+				ss << " - "sv << scene->path;
 			if (regular_renderer)
 				ss << " - "sv << regular_renderer.description->name;
 			win.title(ss.str());
@@ -233,7 +486,7 @@ namespace
 				   .update = [&](float delta_time, bool& backbuffer_dirty) noexcept -> bool
 				   {
 					   if (first_loaded											//
-						   && !scene.path.empty()								//
+						   && !scene->path.empty()								//
 						   && last_scene_write_check.time_since_epoch().count() //
 						   && last_scene_write.time_since_epoch().count()		//
 						   && clock::now() - last_scene_write_check >= 0.5s)
@@ -241,7 +494,7 @@ namespace
 						   last_scene_write_check = clock::now();
 						   try
 						   {
-							   if (fs::last_write_time(scene.path) > last_scene_write)
+							   if (fs::last_write_time(scene->path) > last_scene_write)
 								   reload_requested = true;
 						   }
 						   catch (...)
@@ -251,14 +504,22 @@ namespace
 					   ImGui::Begin("foo");
 					   if (ImGui::Button("reload?"))
 						   reload_requested = true;
+					   ImGui::ProgressBar(win.render_progress());
+					   if (win.interactive)
+						   ImGui::Text("resolution: %d%%, samples: %d%%",
+									   static_cast<int>(win.scaling.scale() * 100.0f + 0.5f),
+									   static_cast<int>(win.scaling.sample_scale() * 100.0f + 0.5f));
 					   ImGui::End();
 
 					   bool reloaded_this_frame = false;
 					   if (reload_requested)
 					   {
+						   // a reload that doesn't change anything visible (e.g. only the file's timestamp changed)
+						   // leaves the progressive render alone rather than starting it again
 						   reload_requested	   = false;
-						   reloaded_this_frame = reload_scene(first_loaded);
-						   first_loaded		   = first_loaded || reloaded_this_frame;
+						   const auto loaded   = reload_scene(first_loaded);
+						   first_loaded		   = first_loaded || loaded;
+						   reloaded_this_frame = loaded && scene_content_changed;
 						   update_title();
 					   }
 
@@ -268,13 +529,13 @@ namespace
 					   {
 						   if (yaw_delta != 0.0f)
 						   {
-							   scene.camera.rotate_yaw(yaw_delta * delta_time);
+							   camera.rotate_yaw(yaw_delta * delta_time);
 							   yaw_delta		= 0.0f;
 							   moved_this_frame = true;
 						   }
 						   if (pitch_delta != 0.0f)
 						   {
-							   scene.camera.rotate_pitch(pitch_delta * delta_time);
+							   camera.rotate_pitch(pitch_delta * delta_time);
 							   pitch_delta		= 0.0f;
 							   moved_this_frame = true;
 						   }
@@ -296,7 +557,7 @@ namespace
 						   auto move = vec3::normalize(move_dir) * delta_time;
 						   if (!muu::approx_zero(move))
 						   {
-							   scene.camera.pose(scene.camera.position() + move, scene.camera.rotation());
+							   camera.pose(camera.position() + move, camera.rotation());
 							   moved_this_frame = true;
 						   }
 					   }
@@ -304,20 +565,49 @@ namespace
 						   moved_this_frame = true;
 					   if (moved_this_frame)
 						   last_move_time = clock::now();
-					   const auto prev_low_res = win.low_res;
-					   win.low_res			   = (clock::now() - last_move_time) < 0.5s;
-					   backbuffer_dirty		   = backbuffer_dirty || moved_this_frame || reloaded_this_frame
-									   || renderer_changed || (win.low_res != prev_low_res);
+					   if (moved_this_frame || reloaded_this_frame)
+						   reset_pending = true;
+					   const auto prev_interactive = win.interactive;
+					   win.interactive			   = (clock::now() - last_move_time) < 0.5s;
+					   backbuffer_dirty			   = backbuffer_dirty || moved_this_frame || reloaded_this_frame
+									   || renderer_changed || (win.interactive != prev_interactive);
 					   renderer_changed = false;
 					   return !should_quit;
 				   },
 
-				   .render =
-					   [&](image_view pixels) noexcept
+				   .render = [&](float sample_scale) -> render_job
 				   {
-					   pixels.clear(colours::black);
-					   if (auto& r = (win.low_res ? low_res_renderer : regular_renderer))
-						   r->render(scene, pixels, threads);
+					   // the job runs on the render thread, so it gets its own copies of everything it needs.
+					   // progressive renderers keep being re-run until they converge or the job is replaced.
+					   // interactive frames are replaced as soon as the camera moves again so they're never refined,
+					   // and what they accumulated is thrown away before the next full-resolution frame.
+					   auto r			 = regular_renderer.object;
+					   const auto reset	 = reset_pending || win.interactive;
+					   const auto refine = !win.interactive;
+					   reset_pending	 = win.interactive;
+
+					   const auto scaled = [=](unsigned count) noexcept
+					   { return muu::max(static_cast<unsigned>(static_cast<float>(count) * sample_scale + 0.5f), 1u); };
+					   auto settings				 = scene->settings();
+					   settings.camera				 = camera;
+					   settings.samples_per_pixel	 = scaled(settings.samples_per_pixel);
+					   settings.adaptive.max_samples = scaled(settings.adaptive.max_samples);
+
+					   return [&threads, r, reset, refine, settings, s = scene](image_view pixels,
+																			   render_control& control) mutable noexcept
+					   {
+						   pixels.clear(colours::black);
+						   if (!r)
+							   return frame_status::complete;
+
+						   if (std::exchange(reset, false))
+							   r->reset();
+						   r->render(*s, settings, pixels, threads, control);
+
+						   if (!control.complete())
+							   return frame_status::cancelled;
+						   return !refine || r->converged() ? frame_status::complete : frame_status::refining;
+					   };
 				   }
 
 		});
@@ -350,6 +640,58 @@ int main(int argc, char** argv)
 			.default_value(std::string{ find_renderer_by_name_fuzzy("mg")->name })
 			.metavar("<name>");
 
+		args.add_argument("--seed")
+			.help("renders deterministically, deriving every random number from this seed") //
+			.nargs(1u)
+			.scan<'u', uint64_t>()
+			.metavar("<int>");
+
+		args.add_argument("-o", "--output")
+			.help("renders a single image to this file (.png, .ppm, or .pfm with renderers that keep a linear image) "
+				  "without opening a window, then exits") //
+			.nargs(1u)
+			.metavar("<path>");
+
+		args.add_argument("--headless")
+			.help("renders a single image without opening a window, then exits") //
+			.flag();
+
+		args.add_argument("--width")
+			.help("image width in headless mode") //
+			.nargs(1u)
+			.default_value(800u)
+			.scan<'u', unsigned>()
+			.metavar("<pixels>");
+
+		args.add_argument("--height")
+			.help("image height in headless mode") //
+			.nargs(1u)
+			.default_value(600u)
+			.scan<'u', unsigned>()
+			.metavar("<pixels>");
+
+		args.add_argument("--frame-budget")
+			.help("how long interactive frames should take to render; the resolution is scaled to fit") //
+			.nargs(1u)
+			.default_value(33.0f)
+			.scan<'g', float>()
+			.metavar("<ms>");
+
+		args.add_argument("--continuous")
+			.help("redraws the window continuously, even when nothing is changing") //
+			.flag();
+
+		args.add_argument("--bench")
+			.help("benchmarks every renderer over the scene(s) and prints the results as JSON, then exits") //
+			.flag();
+
+		args.add_argument("--bench-frames")
+			.help("frames timed per benchmark configuration") //
+			.nargs(1u)
+			.default_value(5u)
+			.scan<'u', unsigned>()
+			.metavar("<count>");
+
 		args.parse_args(argc, argv);
 
 		if (args.get<bool>("list"))
@@ -359,13 +701,23 @@ int main(int argc, char** argv)
 			return 0;
 		}
 
+		// stdout is reserved for the JSON results in bench mode
+		if (args.get<bool>("bench"))
+		{
+			run_bench(args);
+			return 0;
+		}
+
 		log("working directory: "sv, fs::current_path().string());
 
 		log("available renderers: "sv);
 		for (auto& r : renderers::all())
 			log("    ", r.name);
 
-		run(args);
+		if (args.get<bool>("headless") || args.is_used("output"))
+			run_headless(args);
+		else
+			run(args);
 	}
 	catch (const std::exception& ex)
 	{
@@ -0,0 +1,420 @@
+#include "mesh.hpp"
+MUU_DISABLE_WARNINGS;
+#include <array>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <stdexcept>
+#include <filesystem>
+#include <charconv>
+#include <cstring>
+#include <algorithm>
+#include <cctype>
+#include <span>
+#include <sstream>
+#include <bit>
+MUU_ENABLE_WARNINGS;
+
+using namespace rt;
+namespace fs = std::filesystem;
+
+namespace
+{
+	// the whole file is read in one go; parsing straight out of memory is far quicker than going through a stream
+	MUU_NODISCARD
+	static std::string read_file(const fs::path& path)
+	{
+		std::ifstream file{ path, std::ios::binary | std::ios::ate };
+		if (!file)
+			throw std::runtime_error{ "could not open '"s + path.string() + "' for reading"s };
+
+		std::string data;
+		data.resize(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		file.read(data.data(), static_cast<std::streamsize>(data.size()));
+		if (!file)
+			throw std::runtime_error{ "failed reading '"s + path.string() + "'"s };
+		return data;
+	}
+
+	// splits a polygon into a fan of triangles around its first vertex
+	static void triangulate(mesh_data& mesh, std::span<const uint32_t> face)
+	{
+		for (size_t i = 2; i < face.size(); i++)
+			mesh.indices.insert(mesh.indices.end(), { face[0], face[i - 1u], face[i] });
+	}
+
+	//------------------------------------------------------------------------------------------------------------------
+	// obj
+	//------------------------------------------------------------------------------------------------------------------
+
+	struct obj_parser
+	{
+		const fs::path& path;
+		const char* pos;
+		const char* end;
+		size_t line = 1;
+
+		template <typename... T>
+		[[noreturn]]
+		void error(T&&... args) const
+		{
+			std::string msg = path.string() + ":"s + std::to_string(line) + ": "s;
+			((msg += static_cast<T&&>(args)), ...);
+			throw std::runtime_error{ msg };
+		}
+
+		MUU_CONST_INLINE_GETTER
+		static constexpr bool is_space(char c) noexcept
+		{
+			return c == ' ' || c == '\t' || c == '\r';
+		}
+
+		void skip_spaces() noexcept
+		{
+			while (pos < end && is_space(*pos))
+				pos++;
+		}
+
+		MUU_PURE_GETTER
+		bool at_line_end() const noexcept
+		{
+			return pos >= end || *pos == '\n' || *pos == '#';
+		}
+
+		void next_line() noexcept
+		{
+			const auto newline = static_cast<const char*>(std::memchr(pos, '\n', static_cast<size_t>(end - pos)));
+			pos				   = newline ? newline + 1 : end;
+			line++;
+		}
+
+		template <typename T>
+		T number()
+		{
+			skip_spaces();
+			T val{};
+			const auto [ptr, ec] = std::from_chars(pos, end, val);
+			if (ec != std::errc{})
+				error("expected a number"sv);
+			pos = ptr;
+			return val;
+		}
+
+		mesh_data parse()
+		{
+			mesh_data mesh;
+			std::vector<uint32_t> face;
+			while (pos < end)
+			{
+				skip_spaces();
+				if (at_line_end())
+				{
+					next_line();
+					continue;
+				}
+
+				// only positions and faces matter; everything else (normals, uvs, groups, materials) is skipped
+				const auto keyword = pos;
+				while (pos < end && !is_space(*pos) && *pos != '\n')
+					pos++;
+				const auto key = std::string_view{ keyword, static_cast<size_t>(pos - keyword) };
+
+				if (key == "v"sv)
+				{
+					const auto x = number<float>();
+					const auto y = number<float>();
+					const auto z = number<float>();
+					mesh.vertices.push_back(vec3{ x, y, z });
+				}
+				else if (key == "f"sv)
+				{
+					face.clear();
+					for (skip_spaces(); !at_line_end(); skip_spaces())
+					{
+						// v, v/vt, v//vn or v/vt/vn; negative indices count back from the most recent vertex
+						const auto index = number<int64_t>();
+						while (pos < end && !is_space(*pos) && *pos != '\n')
+							pos++;
+
+						const auto vertex_count = static_cast<int64_t>(mesh.vertices.size());
+						const auto resolved		= index < 0 ? vertex_count + index : index - 1;
+						if (index == 0 || resolved < 0 || resolved >= vertex_count)
+							error("vertex index "sv, std::to_string(index), " out-of-range"sv);
+						face.push_back(static_cast<uint32_t>(resolved));
+					}
+					if (face.size() < 3u)
+						error("faces need at least three vertices"sv);
+					triangulate(mesh, face);
+				}
+
+				next_line();
+			}
+			return mesh;
+		}
+	};
+
+	//------------------------------------------------------------------------------------------------------------------
+	// ply
+	//------------------------------------------------------------------------------------------------------------------
+
+	enum class ply_type : uint8_t
+	{
+		int8,
+		uint8,
+		int16,
+		uint16,
+		int32,
+		uint32,
+		float32,
+		float64,
+	};
+
+	MUU_CONST_GETTER
+	static size_t ply_size(ply_type type) noexcept
+	{
+		switch (type)
+		{
+			case ply_type::int8: [[fallthrough]];
+			case ply_type::uint8: return 1u;
+			case ply_type::int16: [[fallthrough]];
+			case ply_type::uint16: return 2u;
+			case ply_type::float64: return 8u;
+			default: return 4u;
+		}
+	}
+
+	struct ply_property
+	{
+		std::string name;
+		ply_type type;
+		ply_type count_type;
+		bool list;
+	};
+
+	struct ply_element
+	{
+		std::string name;
+		size_t count;
+		std::vector<ply_property> properties;
+	};
+
+	struct ply_reader
+	{
+		const fs::path& path;
+		const char* pos;
+		const char* end;
+		bool swap_bytes;
+
+		[[noreturn]]
+		void truncated() const
+		{
+			throw std::runtime_error{ "'"s + path.string() + "' ended unexpectedly"s };
+		}
+
+		template <typename T>
+		MUU_ALWAYS_INLINE
+		T load() noexcept
+		{
+			std::array<char, sizeof(T)> bytes;
+			std::memcpy(bytes.data(), pos, sizeof(T));
+			if (swap_bytes)
+				std::reverse(bytes.begin(), bytes.end());
+			pos += sizeof(T);
+			return muu::bit_cast<T>(bytes);
+		}
+
+		double read(ply_type type)
+		{
+			if (static_cast<size_t>(end - pos) < ply_size(type))
+				truncated();
+
+			switch (type)
+			{
+				case ply_type::int8: return static_cast<double>(load<int8_t>());
+				case ply_type::uint8: return static_cast<double>(load<uint8_t>());
+				case ply_type::int16: return static_cast<double>(load<int16_t>());
+				case ply_type::uint16: return static_cast<double>(load<uint16_t>());
+				case ply_type::int32: return static_cast<double>(load<int32_t>());
+				case ply_type::uint32: return static_cast<double>(load<uint32_t>());
+				case ply_type::float32: return static_cast<double>(load<float>());
+				default: return load<double>();
+			}
+		}
+
+		void skip(const ply_property& prop)
+		{
+			const auto count = prop.list ? static_cast<size_t>(read(prop.count_type)) : 1u;
+			const auto bytes = count * ply_size(prop.type);
+			if (static_cast<size_t>(end - pos) < bytes)
+				truncated();
+			pos += bytes;
+		}
+	};
+
+	MUU_NODISCARD
+	static ply_type parse_ply_type(std::string_view name, const fs::path& path)
+	{
+		static constexpr std::pair<std::string_view, ply_type> names[] = {
+			{ "char"sv, ply_type::int8 },
+			{ "int8"sv, ply_type::int8 },
+			{ "uchar"sv, ply_type::uint8 },
+			{ "uint8"sv, ply_type::uint8 },
+			{ "short"sv, ply_type::int16 },
+			{ "int16"sv, ply_type::int16 },
+			{ "ushort"sv, ply_type::uint16 },
+			{ "uint16"sv, ply_type::uint16 },
+			{ "int"sv, ply_type::int32 },
+			{ "int32"sv, ply_type::int32 },
+			{ "uint"sv, ply_type::uint32 },
+			{ "uint32"sv, ply_type::uint32 },
+			{ "float"sv, ply_type::float32 },
+			{ "float32"sv, ply_type::float32 },
+			{ "double"sv, ply_type::float64 },
+			{ "float64"sv, ply_type::float64 },
+		};
+		for (const auto& [str, type] : names)
+			if (str == name)
+				return type;
+		throw std::runtime_error{ "'"s + path.string() + "' has unknown property type '"s + std::string(name) + "'"s };
+	}
+
+	MUU_NODISCARD
+	static mesh_data parse_ply(std::string_view data, const fs::path& path)
+	{
+		const auto fail = [&](std::string_view msg) { throw std::runtime_error{ "'"s + path.string() + "' "s + msg }; };
+
+		const auto header_end = data.find("end_header"sv);
+		if (!data.starts_with("ply"sv) || header_end == std::string_view::npos)
+			fail("is not a ply file"sv);
+
+		// the header is plain text, so it's fine to tokenize it with a stream
+		std::istringstream header{ std::string{ data.substr(0, header_end) } };
+		std::vector<ply_element> elements;
+		bool big_endian = false;
+		for (std::string line; std::getline(header, line);)
+		{
+			std::istringstream tokens{ line };
+			std::string keyword;
+			tokens >> keyword;
+
+			if (keyword == "format"sv)
+			{
+				std::string format;
+				tokens >> format;
+				if (format == "ascii"sv)
+					fail("is ascii; only binary ply files are supported"sv);
+				big_endian = format == "binary_big_endian"sv;
+			}
+			else if (keyword == "element"sv)
+			{
+				auto& element = elements.emplace_back();
+				tokens >> element.name >> element.count;
+			}
+			else if (keyword == "property"sv)
+			{
+				if (elements.empty())
+					fail("has a property outside of an element"sv);
+
+				std::string type;
+				tokens >> type;
+				auto& prop = elements.back().properties.emplace_back();
+				if (type == "list"sv)
+				{
+					std::string count_type, item_type;
+					tokens >> count_type >> item_type;
+					prop.list		= true;
+					prop.count_type = parse_ply_type(count_type, path);
+					prop.type		= parse_ply_type(item_type, path);
+				}
+				else
+					prop.type = parse_ply_type(type, path);
+				tokens >> prop.name;
+			}
+		}
+
+		auto body = data.substr(header_end);
+		body.remove_prefix(std::min(body.find('\n') + 1u, body.size()));
+
+		auto reader = ply_reader{ path,
+								  body.data(),
+								  body.data() + body.size(),
+								  big_endian != (std::endian::native == std::endian::big) };
+
+		mesh_data mesh;
+		std::vector<uint32_t> face;
+		for (const auto& element : elements)
+		{
+			if (element.name == "vertex"sv)
+			{
+				mesh.vertices.reserve(element.count);
+				for (size_t i = 0; i < element.count; i++)
+				{
+					vec3 pos{};
+					for (const auto& prop : element.properties)
+					{
+						if (prop.list)
+							reader.skip(prop);
+						else if (prop.name.size() == 1u && prop.name[0] >= 'x' && prop.name[0] <= 'z')
+							pos[static_cast<size_t>(prop.name[0] - 'x')] = static_cast<float>(reader.read(prop.type));
+						else
+							reader.skip(prop);
+					}
+					mesh.vertices.push_back(pos);
+				}
+			}
+			else if (element.name == "face"sv)
+			{
+				mesh.indices.reserve(element.count * 3u);
+				for (size_t i = 0; i < element.count; i++)
+				{
+					for (const auto& prop : element.properties)
+					{
+						if (!prop.list || (prop.name != "vertex_indices"sv && prop.name != "vertex_index"sv))
+						{
+							reader.skip(prop);
+							continue;
+						}
+
+						face.resize(static_cast<size_t>(reader.read(prop.count_type)));
+						for (auto& index : face)
+						{
+							const auto val = reader.read(prop.type);
+							if (val < 0.0 || val >= static_cast<double>(mesh.vertices.size()))
+								fail("has a face with an out-of-range vertex index"sv);
+							index = static_cast<uint32_t>(val);
+						}
+						if (face.size() >= 3u)
+							triangulate(mesh, face);
+					}
+				}
+			}
+			else
+			{
+				for (size_t i = 0; i < element.count; i++)
+					for (const auto& prop : element.properties)
+						reader.skip(prop);
+			}
+		}
+		return mesh;
+	}
+}
+
+mesh_data rt::load_mesh(std::string_view path_sv)
+{
+	const auto path = fs::path{ path_sv };
+	auto ext		= path.extension().string();
+	for (auto& c : ext)
+		c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+
+	if (ext != ".obj"sv && ext != ".ply"sv)
+		throw std::runtime_error{ "unsupported mesh format '"s + ext + "' (expected .obj or .ply)"s };
+
+	const auto data = read_file(path);
+	auto mesh		= ext == ".obj"sv ? obj_parser{ path, data.data(), data.data() + data.size() }.parse()
+									  : parse_ply(data, path);
+
+	if (mesh.indices.empty())
+		throw std::runtime_error{ "'"s + path.string() + "' has no triangles"s };
+	return mesh;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include "common.hpp"
+#include "bvh.hpp"
+MUU_DISABLE_WARNINGS;
+#include <vector>
+#include <string>
+#include <filesystem>
+MUU_ENABLE_WARNINGS;
+
+namespace rt
+{
+	// a contiguous range of rows in scene::triangles, with a bvh of its own over just those rows
+	struct mesh
+	{
+		std::string name; // only set for objects, so instances can refer to them
+		std::string path;
+		uint32_t first = 0; // first row in scene::triangles; the bvh's leaf ranges are relative to this
+		uint32_t count = 0;
+		rt::bvh bvh;
+
+		// where the triangles came from, so reloading a scene can tell whether the file needs to be read again
+		std::filesystem::file_time_type write_time;
+		mat3 linear = mat3::constants::identity;
+		vec3 position;
+	};
+
+	// one placement of one of the scene's objects. rays are moved into the object's space rather than the object being
+	// copied into the world, so any number of instances share a single copy of its triangles and bvh.
+	struct instance
+	{
+		mat3 to_world;	// rotation and scale
+		mat3 to_object; // inverse of to_world
+		vec3 position;
+		uint32_t object; // index into scene::objects
+		unsigned material;
+	};
+
+	// the raw contents of a mesh file. faces with more than three vertices have already been split into triangles.
+	struct mesh_data
+	{
+		std::vector<vec3> vertices;
+		std::vector<uint32_t> indices; // three per triangle
+	};
+
+	// reads vertex positions and faces from a .obj or binary .ply file, ignoring everything else.
+	// triangles are expected to be wound counter-clockwise when seen from outside.
+	// throws std::runtime_error on failure.
+	MUU_NODISCARD
+	mesh_data load_mesh(std::string_view path);
+}
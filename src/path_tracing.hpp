@@ -0,0 +1,44 @@
+#pragma once
+#include "common.hpp"
+#include "colour.hpp"
+#include "random.hpp"
+#include "soa.hpp"
+
+// bits shared by the path tracing renderers
+
+namespace rt
+{
+	// the sky seen by rays that escape the scene
+	MUU_PURE_INLINE_GETTER
+	vec3 MUU_VECTORCALL background(const ray& r) noexcept
+	{
+		return vec3::lerp(colours::white.rgb, vec3{ 0.5f, 0.7f, 1.0f }, 0.5f * (r.direction.y + 1.0f));
+	}
+
+	// the fraction of light a material passes on when a path scatters off it. a dielectric's reflectivity column is
+	// its index of refraction, so only the albedo applies there.
+	MUU_PURE_INLINE_GETTER
+	vec3 MUU_VECTORCALL scatter_attenuation(const materials& mats, unsigned material) noexcept
+	{
+		const auto albedo = vec3{ mats.albedo()[material] };
+		return is_dielectric(mats.type()[material]) ? albedo : albedo * mats.reflectivity()[material];
+	}
+
+	// after the first few bounces, paths that can barely contribute anything are ended at random.
+	// survivors are weighted up by the inverse of their survival chance, so the result stays unbiased.
+	inline constexpr unsigned roulette_start_bounce = 3;
+
+	MUU_ALWAYS_INLINE
+	bool MUU_VECTORCALL russian_roulette(vec3& throughput, unsigned bounce) noexcept
+	{
+		if (bounce < roulette_start_bounce)
+			return true;
+
+		const auto survival = muu::min(muu::max(throughput.x, muu::max(throughput.y, throughput.z)), 0.95f);
+		if (random<float>() >= survival)
+			return false;
+
+		throughput /= survival;
+		return true;
+	}
+}
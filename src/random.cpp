@@ -3,25 +3,14 @@ MUU_DISABLE_WARNINGS;
 #include <random>
 MUU_ENABLE_WARNINGS;
 
-namespace
+namespace rt::detail
 {
-	MUU_NODISCARD
-	static auto& random_engine() noexcept
+	uint64_t random_seed() noexcept
 	{
 		MUU_DISABLE_WARNINGS;
 		thread_local std::random_device rdev;
-		thread_local std::mt19937 engine{ rdev() };
 		MUU_ENABLE_WARNINGS;
 
-		return engine;
-	}
-}
-
-namespace rt::detail
-{
-	float random_float() noexcept
-	{
-		thread_local std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
-		return distribution(random_engine());
+		return (static_cast<uint64_t>(rdev()) << 32) | static_cast<uint64_t>(rdev());
 	}
 }
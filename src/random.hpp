@@ -1,14 +1,171 @@
 #pragma once
 #include "common.hpp"
+MUU_DISABLE_WARNINGS;
+#include <optional>
+#include <xsimd/xsimd.hpp>
+MUU_ENABLE_WARNINGS;
 
 namespace rt
 {
+	// pcg32 (pcg-xsh-rr 64/32), see https://www.pcg-random.org
+	class pcg32
+	{
+	  private:
+		uint64_t state_ = 0;
+		uint64_t inc_	= 1;
+
+		static constexpr uint64_t multiplier = 6364136223846793005ull;
+
+	  public:
+		MUU_NODISCARD_CTOR
+		constexpr pcg32() noexcept = default;
+
+		MUU_NODISCARD_CTOR
+		constexpr explicit pcg32(uint64_t seed, uint64_t stream = 0) noexcept //
+			: inc_{ (stream << 1) | 1u }
+		{
+			next_uint();
+			state_ += seed;
+			next_uint();
+		}
+
+		// a generator whose sequence depends only on its inputs, so results don't vary with thread scheduling.
+		// bounce 0 is the camera ray.
+		MUU_PURE_GETTER
+		static constexpr pcg32 for_sample(unsigned pixel, unsigned sample, unsigned bounce, uint64_t seed) noexcept
+		{
+			return pcg32{ mix(seed ^ mix((static_cast<uint64_t>(sample) << 32) | bounce)), pixel };
+		}
+
+		// splitmix64's finalizer
+		MUU_CONST_INLINE_GETTER
+		static constexpr uint64_t mix(uint64_t x) noexcept
+		{
+			x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+			x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+			return x ^ (x >> 31);
+		}
+
+		MUU_ALWAYS_INLINE
+		constexpr uint32_t next_uint() noexcept
+		{
+			const auto prev = state_;
+			state_			= prev * multiplier + inc_;
+
+			const auto xorshifted = static_cast<uint32_t>(((prev >> 18u) ^ prev) >> 27u);
+			const auto rot		  = static_cast<uint32_t>(prev >> 59u);
+			return (xorshifted >> rot) | (xorshifted << ((0u - rot) & 31u));
+		}
+
+		// uniform in [0, 1)
+		MUU_ALWAYS_INLINE
+		constexpr float next_float() noexcept
+		{
+			return static_cast<float>(next_uint() >> 8) * 0x1.0p-24f;
+		}
+	};
+
 	namespace detail
 	{
+		// a fresh non-deterministic seed for a new thread's generator
+		[[nodiscard]]
+		uint64_t random_seed() noexcept;
+
+		MUU_NODISCARD
+		inline pcg32& thread_random_engine() noexcept
+		{
+			MUU_DISABLE_WARNINGS;
+			thread_local pcg32 engine{ random_seed(), random_seed() };
+			MUU_ENABLE_WARNINGS;
+
+			return engine;
+		}
+
+		MUU_ALWAYS_INLINE
+		float random_float() noexcept
+		{
+			return thread_random_engine().next_float();
+		}
+
 		template <typename>
 		struct randomizer;
 	}
 
+	// xoshiro128+ running one independent stream per simd lane, for filling packets of random floats in one go.
+	// see https://prng.di.unimi.it
+	class random_batch
+	{
+	  public:
+		using uint_batch  = xsimd::batch<uint32_t>;
+		using float_batch = xsimd::batch<float>;
+		static_assert(uint_batch::size == float_batch::size);
+
+		static constexpr size_t size = float_batch::size;
+
+	  private:
+		uint_batch s0_, s1_, s2_, s3_;
+
+		template <int K>
+		MUU_PURE_INLINE_GETTER
+		static uint_batch MUU_VECTORCALL rotl(uint_batch x) noexcept
+		{
+			return (x << K) | (x >> (32 - K));
+		}
+
+	  public:
+		// lanes are seeded from consecutive pcg32 outputs so they never start out correlated
+		MUU_NODISCARD_CTOR
+		explicit random_batch(pcg32 seeder) noexcept
+		{
+			alignas(64) uint32_t state[4][size];
+			for (auto& row : state)
+				for (auto& val : row)
+					val = seeder.next_uint() | 1u; // xoshiro's state must not be all zeroes
+
+			s0_ = xsimd::load_aligned(state[0]);
+			s1_ = xsimd::load_aligned(state[1]);
+			s2_ = xsimd::load_aligned(state[2]);
+			s3_ = xsimd::load_aligned(state[3]);
+		}
+
+		// seeds from the calling thread's generator
+		MUU_NODISCARD_CTOR
+		random_batch() noexcept
+			: random_batch{ pcg32{ detail::thread_random_engine().next_uint(),
+								   detail::thread_random_engine().next_uint() } }
+		{}
+
+		MUU_ALWAYS_INLINE
+		uint_batch MUU_VECTORCALL next_uint() noexcept
+		{
+			const auto result = s0_ + s3_;
+			const auto t	  = s1_ << 9;
+
+			s2_ ^= s0_;
+			s3_ ^= s1_;
+			s1_ ^= s2_;
+			s0_ ^= s3_;
+			s2_ ^= t;
+			s3_ = rotl<11>(s3_);
+
+			return result;
+		}
+
+		// uniform in [0, 1). the upper bits of xoshiro128+ are the good ones, so they go into the mantissa.
+		MUU_ALWAYS_INLINE
+		float_batch MUU_VECTORCALL next_float() noexcept
+		{
+			const auto bits = (next_uint() >> 9) | uint_batch{ 0x3F800000u };
+			return xsimd::bitwise_cast<float>(bits) - float_batch{ 1.0f };
+		}
+
+		MUU_ALWAYS_INLINE
+		void fill(float (&out)[size]) noexcept
+		{
+			next_float().store_unaligned(out);
+		}
+	};
+
 	template <typename T>
 	MUU_ALWAYS_INLINE
 	static T MUU_VECTORCALL random() noexcept
@@ -16,14 +173,24 @@ namespace rt
 		return detail::randomizer<T>::get();
 	}
 
-	namespace detail
+	// replaces the calling thread's generator, e.g. with pcg32::for_sample() to make a sample reproducible
+	MUU_ALWAYS_INLINE
+	void seed_random(const pcg32& engine) noexcept
 	{
-		[[nodiscard]]
-		float random_float() noexcept;
+		detail::thread_random_engine() = engine;
+	}
 
-		template <typename>
-		struct randomizer;
+	// when rendering deterministically, reseeds the calling thread's generator from the sample's coordinates
+	// so the result doesn't depend on which thread traced it (or in what order).
+	MUU_ALWAYS_INLINE
+	void seed_random(const std::optional<uint64_t>& seed, unsigned pixel, unsigned sample, unsigned bounce) noexcept
+	{
+		if (seed)
+			seed_random(pcg32::for_sample(pixel, sample, bounce, *seed));
+	}
 
+	namespace detail
+	{
 		template <std::floating_point Float>
 		struct randomizer<Float>
 		{
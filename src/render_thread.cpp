@@ -0,0 +1,144 @@
+#include "render_thread.hpp"
+MUU_DISABLE_WARNINGS;
+#include <algorithm>
+MUU_ENABLE_WARNINGS;
+
+using namespace rt;
+
+render_thread::render_thread(std::function<void()> on_frame) //
+	: on_frame_{ std::move(on_frame) },
+	  thread_{ [this](std::stop_token stop) noexcept { run(stop); } }
+{}
+
+render_thread::~render_thread() noexcept
+{
+	cancel();
+	thread_.request_stop();
+	if (thread_.joinable())
+		thread_.join();
+}
+
+void render_thread::run(std::stop_token stop) noexcept
+{
+	while (true)
+	{
+		render_job job;
+		vec2u size;
+		image_view pixels;
+		std::stop_token job_stop;
+		uint64_t generation;
+		{
+			auto lock = std::unique_lock{ mutex_ };
+			if (!wake_.wait(lock,
+							stop,
+							[&]() noexcept { return job_ && (job_fresh_ || job_repeat_) && target_ && !finished_; }))
+				return;
+
+			job			= std::move(job_);
+			size		= job_size_;
+			pixels		= target_;
+			job_stop	= job_stop_.get_token();
+			generation	= generation_;
+			job_fresh_	= false;
+			job_repeat_ = false;
+			busy_		= true;
+		}
+
+		// the target is the whole back buffer; the job only gets the part matching its resolution
+		const auto frame = image_view{ pixels.data(),
+									   vec2u{ std::min(size.x, pixels.size().x), std::min(size.y, pixels.size().y) },
+									   pixels.stride() };
+		render_control control{ job_stop };
+		{
+			auto lock		= std::scoped_lock{ mutex_ };
+			active_control_ = &control;
+		}
+
+		const auto start  = clock::now();
+		const auto status = job(frame, control);
+		const auto time	  = to_seconds(clock::now() - start);
+
+		const auto published = status != frame_status::cancelled;
+		{
+			auto lock		= std::scoped_lock{ mutex_ };
+			active_control_ = nullptr;
+			busy_			= false;
+
+			// a cancelled frame is only partly drawn, so it's not published and the target stays with this thread
+			// (unless cancel() has taken it back)
+			if (published)
+			{
+				target_	  = {};
+				finished_ = finished_frame{ frame.size(), time };
+			}
+
+			// only hang on to the job if the ui thread hasn't replaced it in the meantime
+			if (generation == generation_)
+			{
+				job_		= std::move(job);
+				job_repeat_ = status == frame_status::refining && !job_stop.stop_requested();
+			}
+		}
+		idle_.notify_all();
+		if (published && on_frame_)
+			on_frame_();
+	}
+}
+
+void render_thread::submit(render_job job, vec2u size)
+{
+	{
+		auto lock = std::scoped_lock{ mutex_ };
+		job_stop_.request_stop();
+		job_stop_	= {};
+		job_		= std::move(job);
+		job_size_	= size;
+		job_fresh_	= true;
+		job_repeat_ = false;
+		generation_++;
+	}
+	wake_.notify_all();
+}
+
+void render_thread::cancel()
+{
+	// the ui thread takes the target back when it cancels, so it's free to unlock or destroy it afterwards
+	{
+		auto lock = std::scoped_lock{ mutex_ };
+		target_	  = {};
+	}
+	submit({}, {});
+}
+
+void render_thread::target(image_view pixels)
+{
+	{
+		auto lock = std::scoped_lock{ mutex_ };
+		target_	  = pixels;
+	}
+	wake_.notify_all();
+}
+
+std::optional<finished_frame> render_thread::take_frame()
+{
+	auto lock = std::scoped_lock{ mutex_ };
+	return std::exchange(finished_, std::nullopt);
+}
+
+void render_thread::wait_idle()
+{
+	auto lock = std::unique_lock{ mutex_ };
+	idle_.wait(lock, [&]() noexcept { return !busy_; });
+}
+
+bool render_thread::busy()
+{
+	auto lock = std::scoped_lock{ mutex_ };
+	return busy_;
+}
+
+float render_thread::progress()
+{
+	auto lock = std::scoped_lock{ mutex_ };
+	return active_control_ ? active_control_->progress() : 1.0f;
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include "image.hpp"
+#include "renderer.hpp"
+MUU_DISABLE_WARNINGS;
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <stop_token>
+#include <optional>
+MUU_ENABLE_WARNINGS;
+
+namespace rt
+{
+	enum class frame_status : unsigned
+	{
+		complete,  // finished; publish it
+		refining,  // finished, but the job wants to run again to improve on it (e.g. progressive rendering)
+		cancelled, // abandoned part-way through; discard it
+	};
+
+	// a unit of work for the render thread. it runs concurrently with the ui thread, so it must only touch state the
+	// ui thread won't modify while it's in flight (capture snapshots, not references).
+	using render_job = std::function<frame_status(image_view, render_control&)>;
+
+	struct finished_frame
+	{
+		vec2u size;
+		float render_time; // seconds
+	};
+
+	// runs render jobs on a dedicated thread so a slow frame never stalls input, imgui or resizing.
+	// the ui thread supplies the memory each frame is rendered into and picks up finished frames with take_frame().
+	class render_thread
+	{
+	  private:
+		std::mutex mutex_;
+		std::condition_variable_any wake_;
+		std::condition_variable idle_;
+		render_job job_;
+		vec2u job_size_		 = {};
+		uint64_t generation_ = 0;	  // bumped whenever the job is replaced
+		bool job_fresh_		 = false; // not yet run since it was submitted
+		bool job_repeat_	 = false; // asked to be run again
+		std::stop_source job_stop_;
+		image_view target_;
+		std::optional<finished_frame> finished_;
+		std::function<void()> on_frame_;
+		render_control* active_control_ = {};
+		bool busy_						= false;
+		std::jthread thread_; // last so it's joined before anything it uses is destroyed
+
+		void run(std::stop_token stop) noexcept;
+
+	  public:
+		// on_frame is called from the render thread whenever a frame is ready for take_frame()
+		MUU_NODISCARD_CTOR
+		explicit render_thread(std::function<void()> on_frame = {});
+
+		~render_thread() noexcept;
+
+		// replaces the current job, rendering at the given size. a frame already in flight is asked to stop.
+		void submit(render_job job, vec2u size);
+
+		// stops the current job without replacing it, and takes back the memory given to target()
+		void cancel();
+
+		// gives the render thread memory for its next frame. ownership returns with take_frame().
+		void target(image_view pixels);
+
+		// the frame finished since the last call, if any
+		MUU_NODISCARD
+		std::optional<finished_frame> take_frame();
+
+		// blocks until no frame is in flight
+		void wait_idle();
+
+		// is a frame in flight?
+		MUU_NODISCARD
+		bool busy();
+
+		// how much of the frame in flight is done, or 1 when idle
+		MUU_NODISCARD
+		float progress();
+	};
+
+	static_assert(!std::is_copy_constructible_v<render_thread>);
+	static_assert(!std::is_copy_assignable_v<render_thread>);
+}
@@ -2,13 +2,84 @@
 #include "common.hpp"
 MUU_DISABLE_WARNINGS;
 #include <span>
+#include <atomic>
+#include <stop_token>
 MUU_ENABLE_WARNINGS;
 
 namespace rt
 {
+	// passed to render() so a frame can be abandoned part-way through (e.g. because the camera moved),
+	// and so the renderer can report how much of it is done. renderers poll it per tile or per batch of samples.
+	class render_control
+	{
+	  private:
+		std::stop_token stop_;
+		std::atomic<float> progress_ = 0.0f;
+
+	  public:
+		MUU_NODISCARD_CTOR
+		render_control() noexcept = default;
+
+		MUU_NODISCARD_CTOR
+		explicit render_control(std::stop_token stop) noexcept //
+			: stop_{ std::move(stop) }
+		{}
+
+		MUU_PURE_INLINE_GETTER
+		bool stop_requested() const noexcept
+		{
+			return stop_.stop_requested();
+		}
+
+		// the fraction of the frame completed so far, in [0, 1]
+		MUU_PURE_INLINE_GETTER
+		float progress() const noexcept
+		{
+			return progress_.load(std::memory_order_relaxed);
+		}
+
+		MUU_ALWAYS_INLINE
+		void progress(float fraction) noexcept
+		{
+			progress_.store(fraction, std::memory_order_relaxed);
+		}
+
+		MUU_PURE_INLINE_GETTER
+		bool complete() const noexcept
+		{
+			return progress() >= 1.0f;
+		}
+	};
+
 	struct MUU_ABSTRACT_INTERFACE renderer_interface
 	{
-		virtual void render(const scene&, image_view&, muu::thread_pool&) noexcept = 0;
+		// renders a frame, stopping early if control.stop_requested(). the pixels of a frame that didn't complete
+		// are unspecified. the camera and sample counts come from the frame_settings, not the scene.
+		virtual void render(const scene&,
+							const frame_settings&,
+							image_view&,
+							muu::thread_pool&,
+							render_control&) noexcept = 0;
+
+		// progressive renderers refine the same image over many calls to render() and return false here until
+		// they've reached the frame's samples_per_pixel.
+		MUU_NODISCARD
+		virtual bool converged() const noexcept
+		{
+			return true;
+		}
+
+		// discards anything accumulated so far (e.g. because the camera moved or the scene was reloaded).
+		virtual void reset() noexcept
+		{}
+
+		// renderers that keep their result as linear radiance (before gamma encoding and quantizing) copy it into out
+		// here, one value per pixel, row-major. returns false if there's only the 8-bit image (e.g. for .pfm output).
+		MUU_NODISCARD
+		virtual bool linear_image(std::span<vec3> /*out*/) const noexcept
+		{
+			return false;
+		}
 
 		virtual ~renderer_interface() noexcept = default;
 	};
@@ -0,0 +1,95 @@
+#include "../scene.hpp"
+#include "../image.hpp"
+#include "../colour.hpp"
+#include "../random.hpp"
+#include "../renderer.hpp"
+#include "../tile_scheduler.hpp"
+#include "../intersection.hpp"
+
+MUU_DISABLE_WARNINGS;
+#include <muu/thread_pool.h>
+#include <cmath>
+MUU_ENABLE_WARNINGS;
+
+using namespace rt;
+
+namespace
+{
+	// how far away something can be and still darken a point. the example scenes are all built at roughly unit scale.
+	static constexpr float occlusion_radius = 2.0f;
+
+	// cosine-weighted, so the fraction of unoccluded samples is the ambient occlusion term without any extra weighting
+	MUU_NODISCARD
+	static vec3 MUU_VECTORCALL random_hemisphere_direction(const vec3& normal) noexcept
+	{
+		const auto u   = random<vec2>();
+		const auto r   = std::sqrt(u.x);
+		const auto phi = floats::two_pi * u.y;
+
+		// any two axes perpendicular to the normal will do
+		const auto helper	 = muu::abs(normal.x) > 0.9f ? vec3{ 0.0f, 1.0f, 0.0f } : vec3{ 1.0f, 0.0f, 0.0f };
+		const auto tangent	 = vec3::normalize(vec3::cross(helper, normal));
+		const auto bitangent = vec3::cross(normal, tangent);
+
+		return vec3::normalize(tangent * (r * std::cos(phi)) + bitangent * (r * std::sin(phi))
+							   + normal * std::sqrt(muu::max(1.0f - u.x, 0.0f)));
+	}
+
+	// one primary ray and one occlusion ray per sample. occlusion rays only need to know whether anything is in the
+	// way, not what, so they go through occluded() and stop at the first thing they hit.
+	[[nodiscard]]
+	static float MUU_VECTORCALL trace(const rt::scene& scene, const ray& r, unsigned pixel, unsigned sample) noexcept
+	{
+		const auto hit = closest_hit(scene, r);
+		if (!hit)
+			return 1.0f;
+
+		seed_random(scene.seed, pixel, sample, 1u);
+
+		const auto normal = face_forward(hit.normal, r.direction);
+		const auto probe  = ray{ r.at(hit.distance), random_hemisphere_direction(normal) };
+		return occluded(scene, probe, occlusion_radius) ? 0.0f : 1.0f;
+	}
+
+	struct ambient_occlusion final : renderer_interface
+	{
+		tile_scheduler tiles;
+
+		void render(const rt::scene& scene,
+					const frame_settings& settings,
+					image_view& pxls,
+					muu::thread_pool& threads,
+					render_control& control) noexcept override
+		{
+			const auto view	  = settings.camera.viewport(pxls.size());
+			const auto worker = [=, &scene, &settings](vec2u screen_pos) noexcept
+			{
+				const auto pixel_index = screen_pos.y * pxls.size().x + screen_pos.x;
+
+				auto visibility = 0.0f;
+				pixel_variance stats;
+				for (unsigned i = 0, e = settings.max_samples_per_pixel();
+					 i < e && !stats.converged(settings.adaptive);
+					 i++)
+				{
+					seed_random(scene.seed, pixel_index, i, 0);
+
+					const auto pos	= vec2{ screen_pos } + (i ? random<vec2>() : vec2{ 0.5f });
+					const auto near = view.screen_to_world(pos, 0.0f);
+					const auto far	= view.screen_to_world(pos, 1.0f);
+
+					const auto sample = trace(scene, ray{ near, vec3::direction(near, far) }, pixel_index, i);
+					visibility += sample;
+					stats.add(vec3{ sample });
+				}
+				visibility /= static_cast<float>(muu::max(stats.count, 1u));
+
+				pxls(screen_pos) = rt::colour{ vec3{ std::sqrt(visibility) } };
+			};
+
+			tiles.for_each_pixel(threads, pxls.size(), control, worker);
+		}
+	};
+
+	REGISTER_RENDERER(ambient_occlusion);
+}
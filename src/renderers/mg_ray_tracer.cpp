@@ -3,11 +3,17 @@
 #include "../colour.hpp"
 #include "../random.hpp"
 #include "../renderer.hpp"
+#include "../tile_scheduler.hpp"
+#include "../intersection.hpp"
+#include "../path_tracing.hpp"
 MUU_DISABLE_WARNINGS;
 #include <muu/thread_pool.h>
 #include <muu/bounding_sphere.h>
 #include <muu/ray.h>
 #include <array>
+#include <vector>
+#include <bit>
+#include <atomic>
 #include <magic_enum.hpp>
 MUU_ENABLE_WARNINGS;
 
@@ -17,90 +23,6 @@ using namespace rt;
 
 namespace
 {
-	static constexpr float min_hit_dist = 0.001f;
-
-	struct hit_result
-	{
-		float distance;
-		vec3 normal;
-		unsigned material;
-
-		MUU_PURE_INLINE_GETTER
-		explicit constexpr operator bool() const noexcept
-		{
-			return distance >= 0.0f;
-		}
-	};
-
-	MUU_PURE_GETTER
-	static hit_result MUU_VECTORCALL test_planes(const rt::scene& scene, const rt::ray r) noexcept
-	{
-		MUU_FMA_BLOCK;
-
-		std::optional<size_t> hit_index;
-		float hit_dist{};
-
-		for (size_t i = 0; i < scene.planes.size(); i++)
-		{
-			const auto obj = scene.planes.value()[i];
-			const auto hit = r.hits(obj);
-			if (!hit || *hit < min_hit_dist || (hit_index && hit_dist <= *hit))
-				continue;
-
-			hit_index = i;
-			hit_dist  = *hit;
-		}
-
-		if (!hit_index)
-			return { -1 };
-
-		return hit_result{ .distance = hit_dist,
-						   .normal	 = scene.planes.value()[*hit_index].normal,
-						   .material = scene.planes.material()[*hit_index] };
-	}
-
-	MUU_PURE_GETTER
-	static hit_result MUU_VECTORCALL test_spheres(const rt::scene& scene, const ray r) noexcept
-	{
-		MUU_FMA_BLOCK;
-
-		std::optional<size_t> hit_index;
-		float hit_dist{};
-
-		for (size_t i = 0; i < scene.spheres.size(); i++)
-		{
-			const auto obj = scene.spheres.value()[i];
-			const auto hit = r.hits(obj);
-			if (!hit || *hit < min_hit_dist || (hit_index && hit_dist <= *hit))
-				continue;
-
-			hit_index = i;
-			hit_dist  = *hit;
-		}
-
-		if (!hit_index)
-			return { -1 };
-
-		return hit_result{ .distance = hit_dist,
-						   .normal	 = vec3::direction(scene.spheres.value()[*hit_index].center, r.at(hit_dist)),
-						   .material = scene.spheres.material()[*hit_index] };
-	}
-
-	MUU_PURE_GETTER
-	static hit_result MUU_VECTORCALL test_boxes(const rt::scene& /*scene*/, const ray /*r*/) noexcept
-	{
-		return { -1 };
-	}
-
-	MUU_PURE_GETTER
-	static hit_result select(const hit_result& a, const hit_result& b) noexcept
-	{
-		if (!a)
-			return b;
-
-		return !b || a.distance <= b.distance ? a : b;
-	}
-
 	using scatter_func = std::optional<ray> MUU_VECTORCALL(const rt::scene& scene,
 														   const ray& r,
 														   const hit_result& hit,
@@ -112,11 +34,12 @@ namespace
 															 const hit_result& hit,
 															 vec3& attenuation) noexcept
 	{
-		attenuation = vec3{ scene.materials.albedo()[hit.material] * scene.materials.reflectivity()[hit.material] };
+		attenuation = scatter_attenuation(scene.materials, hit.material);
 
-		auto scatter = hit.normal + random_unit_vector();
+		const auto normal = face_forward(hit.normal, r.direction);
+		auto scatter	  = normal + random_unit_vector();
 		if (scatter.approx_zero())
-			scatter = hit.normal;
+			scatter = normal;
 		scatter.normalize();
 
 		return ray{ r.at(hit.distance), scatter };
@@ -128,11 +51,12 @@ namespace
 														   const hit_result& hit,
 														   vec3& attenuation) noexcept
 	{
-		attenuation = vec3{ scene.materials.albedo()[hit.material] * scene.materials.reflectivity()[hit.material] };
+		attenuation = scatter_attenuation(scene.materials, hit.material);
 
-		vec3 scatter = reflect(vec3::normalize(r.direction), hit.normal)
-					 + scene.materials.roughness()[hit.material] * random_unit_vector();
-		if (vec3::dot(scatter, hit.normal) <= 0.0f)
+		const auto normal = face_forward(hit.normal, r.direction);
+		vec3 scatter	  = reflect(vec3::normalize(r.direction), normal)
+						  + scene.materials.roughness()[hit.material] * random_unit_vector();
+		if (vec3::dot(scatter, normal) <= 0.0f)
 			return {};
 
 		scatter.normalize();
@@ -152,58 +76,300 @@ namespace
 	}();
 
 	[[nodiscard]]
-	static vec3 MUU_VECTORCALL trace(const rt::scene& scene, const ray r, unsigned max_bounces) noexcept
+	static vec3 MUU_VECTORCALL trace(const rt::scene& scene, ray r, unsigned pixel, unsigned sample) noexcept
 	{
-		if (!(max_bounces--))
-			return {};
+		auto throughput = vec3::constants::one;
+		for (unsigned bounce = 0; bounce < scene.max_bounces; bounce++)
+		{
+			const auto hit = closest_hit(scene, r);
+			if (!hit)
+				return throughput * background(r);
 
-		auto hit = test_planes(scene, r);
-		hit		 = select(test_spheres(scene, r), hit);
-		hit		 = select(test_boxes(scene, r), hit);
-		if (!hit)
-			return vec3::lerp(colours::white.rgb, vec3{ 0.5f, 0.7f, 1.0f }, 0.5f * (r.direction.y + 1.0f));
+			seed_random(scene.seed, pixel, sample, bounce + 1u);
 
-		vec3 attenuation;
-		if (const auto scatter = scatter_funcs[static_cast<size_t>(scene.materials.type()[hit.material])](scene, //
+			vec3 attenuation;
+			const auto scatter = scatter_funcs[static_cast<size_t>(scene.materials.type()[hit.material])](scene, //
 																										  r,
 																										  hit,
-																										  attenuation))
-			return attenuation * trace(scene, *scatter, max_bounces);
+																										  attenuation);
+			if (!scatter)
+				return {};
+
+			throughput *= attenuation;
+			if (!russian_roulette(throughput, bounce))
+				return {};
+
+			r = *scatter;
+		}
 
 		return {};
 	}
 
 	struct mg_ray_tracer final : renderer_interface
 	{
-		void render(const rt::scene& scene, image_view& pixels, muu::thread_pool& threads) noexcept override
+		// samples added to the accumulation buffer per call to render(), so the window stays responsive
+		static constexpr unsigned samples_per_frame = 4;
+
+		tile_scheduler tiles;
+		std::vector<vec3> accumulation;			// linear HDR radiance summed over all samples so far
+		std::vector<pixel_variance> statistics; // per-pixel sample counts and luminance variance
+		vec2u accumulation_size = {};
+		bool started			= false;
+		unsigned unfinished		= 0; // pixels still wanting samples after the last frame
+
+		MUU_NODISCARD
+		bool converged() const noexcept override
+		{
+			return started && !unfinished;
+		}
+
+		void reset() noexcept override
+		{
+			started = false;
+		}
+
+		MUU_NODISCARD
+		bool linear_image(std::span<vec3> out) const noexcept override
+		{
+			if (!started || out.size() != accumulation.size())
+				return false;
+
+			for (size_t i = 0; i < accumulation.size(); i++)
+				out[i] = accumulation[i] / static_cast<float>(muu::max(statistics[i].count, 1u));
+			return true;
+		}
+
+		void render(const rt::scene& scene,
+					const frame_settings& settings,
+					image_view& pixels,
+					muu::thread_pool& threads,
+					render_control& control) noexcept override
 		{
-			const auto view = scene.camera.viewport(pixels.size());
+			if (accumulation_size != pixels.size())
+			{
+				accumulation_size = pixels.size();
+				accumulation.resize(accumulation_size.x * accumulation_size.y);
+				statistics.resize(accumulation.size());
+				started = false;
+			}
+			if (!started)
+			{
+				std::fill(accumulation.begin(), accumulation.end(), vec3{});
+				std::fill(statistics.begin(), statistics.end(), pixel_variance{});
+			}
 
-			const auto worker = [=, &scene](unsigned pixel_index) noexcept
+			// with adaptive sampling enabled pixels drop out as soon as they're converged,
+			// so later frames only spend time on the noisy parts of the image
+			const auto max_samples = settings.max_samples_per_pixel();
+			const auto view		   = settings.camera.viewport(pixels.size());
+			std::atomic_uint remaining{};
+
+			const auto worker = [=, &scene, &settings, &remaining, this](vec2u screen_pos) noexcept
 			{
-				const auto screen_pos = pixels.position_of(pixel_index);
+				const auto pixel_index = screen_pos.y * accumulation_size.x + screen_pos.x;
 
-				auto colour = vec3{};
-				for (unsigned i = 0, e = scene.samples_per_pixel; i < e; i++)
+				auto& sum	= accumulation[pixel_index];
+				auto& stats = statistics[pixel_index];
+				for (unsigned i = stats.count, e = muu::min(stats.count + samples_per_frame, max_samples);
+					 i < e && !stats.converged(settings.adaptive);
+					 i++)
 				{
+					seed_random(scene.seed, pixel_index, i, 0);
+
 					const auto pos	= vec2{ screen_pos } + (i ? random<vec2>() : vec2{ 0.5f });
 					const auto near = view.screen_to_world(pos, 0.0f);
 					const auto far	= view.screen_to_world(pos, 1.0f);
 
-					colour += trace(scene, ray{ near, vec3::direction(near, far) }, scene.max_bounces);
+					const auto radiance = trace(scene, ray{ near, vec3::direction(near, far) }, pixel_index, i);
+					sum += radiance;
+					stats.add(radiance);
 				}
-				colour /= static_cast<float>(scene.samples_per_pixel);
-				colour.x = std::sqrt(colour.x);
-				colour.y = std::sqrt(colour.y);
-				colour.z = std::sqrt(colour.z);
+
+				if (stats.count < max_samples && !stats.converged(settings.adaptive))
+					remaining.fetch_add(1u, std::memory_order_relaxed);
+
+				auto colour = sum / static_cast<float>(muu::max(stats.count, 1u));
+				colour.x	= std::sqrt(colour.x);
+				colour.y	= std::sqrt(colour.y);
+				colour.z	= std::sqrt(colour.z);
 
 				pixels(screen_pos) = rt::colour{ colour };
 			};
 
-			threads.for_range(unsigned{}, pixels.size().x * pixels.size().y, worker);
-			threads.wait();
+			tiles.for_each_pixel(threads, pixels.size(), control, worker);
+			started	   = true;
+			unfinished = remaining.load(std::memory_order_relaxed);
+
+			// pixels in tiles that were skipped didn't get their samples this frame
+			if (!control.complete())
+				unfinished = muu::max(unfinished, 1u);
 		}
 	};
 
 	REGISTER_RENDERER(mg_ray_tracer);
+
+	// traces one packet of rays to completion, one bounce at a time. lanes drop out of the mask as their paths end.
+	static void MUU_VECTORCALL trace_packet(const rt::scene& scene,
+											ray (&rays)[packet_size],
+											uint32_t active_lanes,
+											const unsigned (&pixel_index)[packet_size],
+											unsigned sample,
+											vec3 (&radiance)[packet_size]) noexcept
+	{
+		vec3 throughput[packet_size];
+		for (auto& t : throughput)
+			t = vec3::constants::one;
+
+		hit_result hits[packet_size];
+		for (unsigned bounce = 0; bounce < scene.max_bounces && active_lanes; bounce++)
+		{
+			test_packet(scene, ray_packet{ rays }, active_lanes, hits);
+
+			for (auto bits = active_lanes; bits; bits &= bits - 1u)
+			{
+				const auto lane = static_cast<size_t>(std::countr_zero(bits));
+				const auto mask = 1u << lane;
+
+				const auto& hit = hits[lane];
+				if (!hit)
+				{
+					radiance[lane] += throughput[lane] * background(rays[lane]);
+					active_lanes &= ~mask;
+					continue;
+				}
+
+				seed_random(scene.seed, pixel_index[lane], sample, bounce + 1u);
+
+				vec3 attenuation;
+				const auto scatter = scatter_funcs[static_cast<size_t>(scene.materials.type()[hit.material])](scene, //
+																											  rays[lane],
+																											  hit,
+																											  attenuation);
+				if (!scatter)
+				{
+					active_lanes &= ~mask;
+					continue;
+				}
+
+				throughput[lane] *= attenuation;
+				if (!russian_roulette(throughput[lane], bounce))
+				{
+					active_lanes &= ~mask;
+					continue;
+				}
+
+				rays[lane] = *scatter;
+			}
+		}
+	}
+
+	// same output as mg_ray_tracer, but pixels are traced in small blocks so neighbouring rays share
+	// traversal and intersection work across simd lanes (4x2 with AVX2).
+	struct mg_packet_tracer final : renderer_interface
+	{
+		static constexpr unsigned block_width  = static_cast<unsigned>(packet_size / 2u);
+		static constexpr unsigned block_height = 2;
+		static_assert(block_width * block_height == packet_size);
+
+		tile_scheduler tiles;
+
+		void render(const rt::scene& scene,
+					const frame_settings& settings,
+					image_view& pixels,
+					muu::thread_pool& threads,
+					render_control& control) noexcept override
+		{
+			const auto view = settings.camera.viewport(pixels.size());
+
+			const auto worker = [=, &scene, &settings](vec2u block_pos) noexcept
+			{
+				vec2u screen_pos[packet_size];
+				unsigned pixel_index[packet_size];
+				uint32_t in_bounds = 0;
+				for (unsigned i = 0; i < packet_size; i++)
+				{
+					screen_pos[i]  = block_pos + vec2u{ i % block_width, i / block_width };
+					pixel_index[i] = screen_pos[i].y * pixels.size().x + screen_pos[i].x;
+					if (screen_pos[i].x < pixels.size().x && screen_pos[i].y < pixels.size().y)
+						in_bounds |= 1u << i;
+				}
+
+				static_assert(random_batch::size == packet_size);
+				random_batch jitter;
+				float jitter_x[packet_size];
+				float jitter_y[packet_size];
+
+				vec3 colour[packet_size] = {};
+				pixel_variance stats[packet_size];
+				ray rays[packet_size];
+				auto active = in_bounds;
+				for (unsigned s = 0, e = settings.max_samples_per_pixel(); s < e && active; s++)
+				{
+					// seeded jitter comes from each pixel's own stream (the same one mg_ray_tracer uses), so it doesn't
+					// depend on which block or lane the pixel landed in
+					if (scene.seed)
+					{
+						for (unsigned i = 0; i < packet_size; i++)
+						{
+							seed_random(scene.seed, pixel_index[i], s, 0);
+							jitter_x[i] = random<float>();
+							jitter_y[i] = random<float>();
+						}
+					}
+					else
+					{
+						jitter.fill(jitter_x);
+						jitter.fill(jitter_y);
+					}
+
+					for (size_t i = 0; i < packet_size; i++)
+					{
+						const auto pos =
+							vec2{ screen_pos[i] } + (s ? vec2{ jitter_x[i], jitter_y[i] } : vec2{ 0.5f });
+						const auto near = view.screen_to_world(pos, 0.0f);
+						const auto far	= view.screen_to_world(pos, 1.0f);
+						rays[i]			= ray{ near, vec3::direction(near, far) };
+					}
+
+					vec3 radiance[packet_size] = {};
+					trace_packet(scene, rays, active, pixel_index, s, radiance);
+
+					// converged pixels drop out of the packet; the rest keep tracing as a (narrower) group
+					for (auto bits = active; bits; bits &= bits - 1u)
+					{
+						const auto lane = static_cast<size_t>(std::countr_zero(bits));
+						colour[lane] += radiance[lane];
+						stats[lane].add(radiance[lane]);
+						if (stats[lane].converged(settings.adaptive))
+							active &= ~(1u << lane);
+					}
+				}
+
+				for (unsigned i = 0; i < packet_size; i++)
+				{
+					if (!(in_bounds & (1u << i)))
+						continue;
+
+					auto c = colour[i] / static_cast<float>(muu::max(stats[i].count, 1u));
+					c.x	   = std::sqrt(c.x);
+					c.y	   = std::sqrt(c.y);
+					c.z	   = std::sqrt(c.z);
+
+					pixels(screen_pos[i]) = rt::colour{ c };
+				}
+			};
+
+			tiles.run(threads,
+					  pixels.size(),
+					  control,
+					  [&](const tile& t) noexcept
+					  {
+						  for (unsigned y = 0; y < t.size.y; y += block_height)
+							  for (unsigned x = 0; x < t.size.x; x += block_width)
+								  worker(t.start + vec2u{ x, y });
+					  });
+		}
+	};
+
+	REGISTER_RENDERER(mg_packet_tracer);
 }
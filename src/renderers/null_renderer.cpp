@@ -6,9 +6,13 @@ namespace
 {
 	struct null_renderer final : renderer_interface
 	{
-		void render(const rt::scene& /*scene*/, image_view& /*pixels*/, muu::thread_pool& /*threads*/) noexcept override
+		void render(const rt::scene& /*scene*/,
+					const frame_settings& /*settings*/,
+					image_view& /*pixels*/,
+					muu::thread_pool& /*threads*/,
+					render_control& control) noexcept override
 		{
-			//
+			control.progress(1.0f);
 		}
 	};
 
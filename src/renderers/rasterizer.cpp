@@ -1,6 +1,8 @@
 #include "../scene.hpp"
+#include "../intersection.hpp"
 #include "../image.hpp"
 #include "../renderer.hpp"
+#include "../tile_scheduler.hpp"
 MUU_DISABLE_WARNINGS;
 #include <muu/thread_pool.h>
 MUU_ENABLE_WARNINGS;
@@ -21,16 +23,21 @@ namespace
 
 	struct rasterizer final : renderer_interface
 	{
-		void render(const rt::scene& scene, image_view& pixels, muu::thread_pool& threads) noexcept override
+		tile_scheduler tiles;
+
+		void render(const rt::scene& scene,
+					const frame_settings& settings,
+					image_view& pixels,
+					muu::thread_pool& threads,
+					render_control& control) noexcept override
 		{
-			const auto view = scene.camera.viewport(pixels.size());
+			const auto view = settings.camera.viewport(pixels.size());
 
-			const auto worker = [=, &scene](unsigned pixel_index) noexcept
+			const auto worker = [=, &scene](vec2u screen_pos) noexcept
 			{
-				const auto screen_pos = pixels.position_of(pixel_index);
-				const auto near_pos	  = view.screen_to_world(vec2{ screen_pos } + vec2{ 0.5f }, 0.0f);
-				const auto far_pos	  = view.screen_to_world(vec2{ screen_pos } + vec2{ 0.5f }, 1.0f);
-				const auto max_dist	  = vec3::distance(near_pos, far_pos);
+				const auto near_pos = view.screen_to_world(vec2{ screen_pos } + vec2{ 0.5f }, 0.0f);
+				const auto far_pos	= view.screen_to_world(vec2{ screen_pos } + vec2{ 0.5f }, 1.0f);
+				const auto max_dist = vec3::distance(near_pos, far_pos);
 
 				float dist		  = max_dist + 1.0f;
 				auto hit_material = static_cast<unsigned>(-1);
@@ -62,6 +69,17 @@ namespace
 				hit_tests(scene.boxes);
 				hit_tests(scene.spheres);
 
+				// triangles have no muu primitive type to call r.hits() with, so they go through the bvhs instead
+				const auto hit = select(test_triangles(scene, r), test_instances(scene, r));
+				add_traced_rays(1u); // one primary ray per pixel, however many structures it was tested against
+				if (hit && hit.distance < dist)
+				{
+					dist		 = hit.distance;
+					hit_material = hit.material;
+					hit_pos		 = r.at(hit.distance);
+					hit_normal	 = hit.normal;
+				}
+
 				static constexpr auto sky_end	= colour{ 238, 245, 255 };
 				static constexpr auto sky_start = colour{ 208, 228, 255 };
 
@@ -82,8 +100,7 @@ namespace
 																/ static_cast<float>(pixels.size().y - 1u)) };
 			};
 
-			threads.for_range(unsigned{}, pixels.size().x * pixels.size().y, worker);
-			threads.wait();
+			tiles.for_each_pixel(threads, pixels.size(), control, worker);
 		}
 	};
 
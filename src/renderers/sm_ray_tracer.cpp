@@ -3,6 +3,9 @@
 #include "../colour.hpp"
 #include "../random.hpp"
 #include "../renderer.hpp"
+#include "../tile_scheduler.hpp"
+#include "../intersection.hpp"
+#include "../path_tracing.hpp"
 
 MUU_DISABLE_WARNINGS;
 #include <muu/thread_pool.h>
@@ -17,90 +20,6 @@ using namespace rt;
 namespace
 {
 
-	static constexpr float min_hit_dist = 0.001f;
-
-	struct hit_result
-	{
-		float distance;
-		vec3 normal;
-		unsigned material;
-
-		MUU_PURE_INLINE_GETTER
-		explicit constexpr operator bool() const noexcept
-		{
-			return distance >= 0.0f;
-		}
-	};
-
-	MUU_PURE_GETTER
-	static hit_result MUU_VECTORCALL test_planes(const rt::scene& scene, const rt::ray r) noexcept
-	{
-		MUU_FMA_BLOCK;
-
-		std::optional<size_t> hit_index;
-		float hit_dist{};
-
-		for (size_t i = 0; i < scene.planes.size(); i++)
-		{
-			const auto obj = scene.planes.value()[i];
-			const auto hit = r.hits(obj);
-			if (!hit || *hit < min_hit_dist || (hit_index && hit_dist <= *hit))
-				continue;
-
-			hit_index = i;
-			hit_dist  = *hit;
-		}
-
-		if (!hit_index)
-			return { -1 };
-
-		return hit_result{ .distance = hit_dist,
-						   .normal	 = scene.planes.value()[*hit_index].normal,
-						   .material = scene.planes.material()[*hit_index] };
-	}
-
-	MUU_PURE_GETTER
-	static hit_result MUU_VECTORCALL test_spheres(const rt::scene& scene, const ray r) noexcept
-	{
-		MUU_FMA_BLOCK;
-
-		std::optional<size_t> hit_index;
-		float hit_dist{};
-
-		for (size_t i = 0; i < scene.spheres.size(); i++)
-		{
-			const auto obj = scene.spheres.value()[i];
-			const auto hit = r.hits(obj);
-			if (!hit || *hit < min_hit_dist || (hit_index && hit_dist <= *hit))
-				continue;
-
-			hit_index = i;
-			hit_dist  = *hit;
-		}
-
-		if (!hit_index)
-			return { -1 };
-
-		return hit_result{ .distance = hit_dist,
-						   .normal	 = vec3::direction(scene.spheres.value()[*hit_index].center, r.at(hit_dist)),
-						   .material = scene.spheres.material()[*hit_index] };
-	}
-
-	MUU_PURE_GETTER
-	static hit_result MUU_VECTORCALL test_boxes(const rt::scene& /*scene*/, const ray /*r*/) noexcept
-	{
-		return { -1 };
-	}
-
-	MUU_PURE_GETTER
-	static hit_result select(const hit_result& a, const hit_result& b) noexcept
-	{
-		if (!a)
-			return b;
-
-		return !b || a.distance <= b.distance ? a : b;
-	}
-
 	using scatter_func = std::optional<ray> MUU_VECTORCALL(const rt::scene& scene,
 														   const ray& r,
 														   const hit_result& hit,
@@ -112,11 +31,12 @@ namespace
 															 const hit_result& hit,
 															 vec3& attenuation) noexcept
 	{
-		attenuation = vec3{ scene.materials.albedo()[hit.material] * scene.materials.reflectivity()[hit.material] };
+		attenuation = scatter_attenuation(scene.materials, hit.material);
 
-		auto scatter = hit.normal + random_unit_vector();
+		const auto normal = face_forward(hit.normal, r.direction);
+		auto scatter	  = normal + random_unit_vector();
 		if (scatter.approx_zero())
-			scatter = hit.normal;
+			scatter = normal;
 		scatter.normalize();
 
 		return ray{ r.at(hit.distance), scatter };
@@ -128,11 +48,12 @@ namespace
 														   const hit_result& hit,
 														   vec3& attenuation) noexcept
 	{
-		attenuation = vec3{ scene.materials.albedo()[hit.material] * scene.materials.reflectivity()[hit.material] };
+		attenuation = scatter_attenuation(scene.materials, hit.material);
 
-		vec3 scatter = reflect(vec3::normalize(r.direction), hit.normal)
-					 + scene.materials.roughness()[hit.material] * random_unit_vector();
-		if (vec3::dot(scatter, hit.normal) <= 0.0f)
+		const auto normal = face_forward(hit.normal, r.direction);
+		vec3 scatter	  = reflect(vec3::normalize(r.direction), normal)
+						  + scene.materials.roughness()[hit.material] * random_unit_vector();
+		if (vec3::dot(scatter, normal) <= 0.0f)
 			return {};
 
 		scatter.normalize();
@@ -191,7 +112,7 @@ namespace
 		float reflect_prob;
 		float cosine;
 
-		attenuation = vec3{ scene.materials.albedo()[hit.material] * scene.materials.reflectivity()[hit.material] };
+		attenuation = scatter_attenuation(scene.materials, hit.material);
 
 		if (vec3::dot(r.direction, hit.normal) > 0.0f)
 		{
@@ -236,47 +157,67 @@ namespace
 	}();
 
 	[[nodiscard]]
-	static vec3 MUU_VECTORCALL trace(const rt::scene& scene, const ray r, unsigned max_bounces) noexcept
+	static vec3 MUU_VECTORCALL trace(const rt::scene& scene, ray r, unsigned pixel, unsigned sample) noexcept
 	{
-		if (!(max_bounces--))
-			return {};
-
-		auto hit = test_planes(scene, r);
-		hit		 = select(test_spheres(scene, r), hit);
-		hit		 = select(test_boxes(scene, r), hit);
-		if (!hit)
-			return vec3::lerp(colours::white.rgb, vec3{ 0.5f, 0.7f, 1.0f }, 0.5f * (r.direction.y + 1.0f));
+		auto throughput = vec3::constants::one;
+		for (unsigned bounce = 0; bounce < scene.max_bounces; bounce++)
+		{
+			const auto hit = closest_hit(scene, r);
+			if (!hit)
+				return throughput * background(r);
 
-		vec3 attenuation;
+			seed_random(scene.seed, pixel, sample, bounce + 1u);
 
-		if (const auto scatter = scatter_funcs[static_cast<size_t>(scene.materials.type()[hit.material])](scene, //
+			vec3 attenuation;
+			const auto scatter = scatter_funcs[static_cast<size_t>(scene.materials.type()[hit.material])](scene, //
 																										  r,
 																										  hit,
-																										  attenuation))
-			return attenuation * trace(scene, *scatter, max_bounces);
+																										  attenuation);
+			if (!scatter)
+				return {};
+
+			throughput *= attenuation;
+			if (!russian_roulette(throughput, bounce))
+				return {};
+
+			r = *scatter;
+		}
 
 		return {};
 	}
 
 	struct sm_ray_tracer final : renderer_interface
 	{
-		void render(const rt::scene& scene, image_view& pxls, muu::thread_pool& threads) noexcept override
+		tile_scheduler tiles;
+
+		void render(const rt::scene& scene,
+					const frame_settings& settings,
+					image_view& pxls,
+					muu::thread_pool& threads,
+					render_control& control) noexcept override
 		{
-			const auto view	  = scene.camera.viewport(pxls.size());
-			const auto worker = [=, &scene](unsigned pixel_index) noexcept
+			const auto view	  = settings.camera.viewport(pxls.size());
+			const auto worker = [=, &scene, &settings](vec2u screen_pos) noexcept
 			{
-				const auto screen_pos = pxls.position_of(pixel_index);
+				const auto pixel_index = screen_pos.y * pxls.size().x + screen_pos.x;
 
 				auto colour = vec3{};
-				for (unsigned i = 0, e = scene.samples_per_pixel; i < e; i++)
+				pixel_variance stats;
+				for (unsigned i = 0, e = settings.max_samples_per_pixel();
+					 i < e && !stats.converged(settings.adaptive);
+					 i++)
 				{
+					seed_random(scene.seed, pixel_index, i, 0);
+
 					const auto pos	= vec2{ screen_pos } + (i ? random<vec2>() : vec2{ 0.5f });
 					const auto near = view.screen_to_world(pos, 0.0f);
 					const auto far	= view.screen_to_world(pos, 1.0f);
 
-					colour += trace(scene, ray{ near, vec3::direction(near, far) }, scene.max_bounces);
+					const auto radiance = trace(scene, ray{ near, vec3::direction(near, far) }, pixel_index, i);
+					colour += radiance;
+					stats.add(radiance);
 				}
-				colour /= static_cast<float>(scene.samples_per_pixel);
+				colour /= static_cast<float>(muu::max(stats.count, 1u));
 				colour.x = std::sqrt(colour.x);
 				colour.y = std::sqrt(colour.y);
 				colour.z = std::sqrt(colour.z);
@@ -284,8 +225,7 @@ namespace
 				pxls(screen_pos) = rt::colour{ colour };
 			};
 
-			threads.for_range(unsigned{}, pxls.size().x * pxls.size().y, worker);
-			threads.wait();
+			tiles.for_each_pixel(threads, pxls.size(), control, worker);
 		}
 	};
 
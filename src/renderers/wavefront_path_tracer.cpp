@@ -0,0 +1,502 @@
+#include "../scene.hpp"
+#include "../image.hpp"
+#include "../colour.hpp"
+#include "../random.hpp"
+#include "../renderer.hpp"
+#include "../tile_scheduler.hpp"
+#include "../intersection.hpp"
+#include "../path_tracing.hpp"
+MUU_DISABLE_WARNINGS;
+#include <muu/thread_pool.h>
+#include <muu/ray.h>
+#include <array>
+#include <vector>
+#include <magic_enum.hpp>
+MUU_ENABLE_WARNINGS;
+
+MUU_FORCE_NDEBUG_OPTIMIZATIONS;
+
+using namespace rt;
+
+namespace
+{
+	inline constexpr size_t material_type_count = magic_enum::enum_count<material_type>();
+
+	// rays that missed everything are sorted into their own bucket after all the material types
+	inline constexpr size_t miss_bucket	 = material_type_count;
+	inline constexpr size_t bucket_count = material_type_count + 1u;
+
+	// sort() and compact() split the queue into chunks of this many rays so they can run on the thread pool:
+	// each chunk is counted separately, a prefix sum over the counts gives every chunk its output range,
+	// then the chunks all scatter into their ranges at once.
+	inline constexpr unsigned chunk_size = 4096;
+
+	struct ray_queue
+	{
+		std::vector<float> origin_x, origin_y, origin_z;
+		std::vector<float> dir_x, dir_y, dir_z;
+		std::vector<float> throughput_x, throughput_y, throughput_z;
+		std::vector<unsigned> pixel;
+		size_t size = 0;
+
+		void resize(size_t count)
+		{
+			for (auto col : { &origin_x, &origin_y, &origin_z, &dir_x, &dir_y, &dir_z })
+				col->resize(count);
+			for (auto col : { &throughput_x, &throughput_y, &throughput_z })
+				col->resize(count);
+			pixel.resize(count);
+			size = count;
+		}
+
+		MUU_PURE_INLINE_GETTER
+		ray get_ray(size_t i) const noexcept
+		{
+			return ray{ vec3{ origin_x[i], origin_y[i], origin_z[i] }, vec3{ dir_x[i], dir_y[i], dir_z[i] } };
+		}
+
+		MUU_ALWAYS_INLINE
+		void set_ray(size_t i, const ray& r) noexcept
+		{
+			origin_x[i] = r.origin.x;
+			origin_y[i] = r.origin.y;
+			origin_z[i] = r.origin.z;
+			dir_x[i]	= r.direction.x;
+			dir_y[i]	= r.direction.y;
+			dir_z[i]	= r.direction.z;
+		}
+
+		MUU_PURE_INLINE_GETTER
+		vec3 get_throughput(size_t i) const noexcept
+		{
+			return vec3{ throughput_x[i], throughput_y[i], throughput_z[i] };
+		}
+
+		MUU_ALWAYS_INLINE
+		void set_throughput(size_t i, const vec3& t) noexcept
+		{
+			throughput_x[i] = t.x;
+			throughput_y[i] = t.y;
+			throughput_z[i] = t.z;
+		}
+
+		MUU_ALWAYS_INLINE
+		void copy_to(ray_queue& dest, size_t from, size_t to) const noexcept
+		{
+			dest.set_ray(to, get_ray(from));
+			dest.set_throughput(to, get_throughput(from));
+			dest.pixel[to] = pixel[from];
+		}
+	};
+
+	struct hit_queue
+	{
+		std::vector<float> distance;
+		std::vector<float> normal_x, normal_y, normal_z;
+		std::vector<unsigned> material;
+		std::vector<uint8_t> bucket;
+
+		void resize(size_t count)
+		{
+			for (auto col : { &distance, &normal_x, &normal_y, &normal_z })
+				col->resize(count);
+			material.resize(count);
+			bucket.resize(count);
+		}
+
+		MUU_PURE_INLINE_GETTER
+		hit_result get(size_t i) const noexcept
+		{
+			return hit_result{ .distance = distance[i],
+							   .normal	 = vec3{ normal_x[i], normal_y[i], normal_z[i] },
+							   .material = material[i] };
+		}
+
+		MUU_ALWAYS_INLINE
+		void set(size_t i, const hit_result& hit, uint8_t bucket_index) noexcept
+		{
+			distance[i] = hit.distance;
+			normal_x[i] = hit.normal.x;
+			normal_y[i] = hit.normal.y;
+			normal_z[i] = hit.normal.z;
+			material[i] = hit.material;
+			bucket[i]	= bucket_index;
+		}
+	};
+
+	struct wavefront
+	{
+		ray_queue rays;
+		ray_queue compacted; // compact() copies the surviving paths here, then swaps it with rays
+		hit_queue hits;
+		std::vector<uint8_t> alive;
+		std::vector<unsigned> order; // ray indices grouped by bucket
+		std::array<unsigned, bucket_count + 1u> bucket_offsets{};
+		std::vector<std::array<unsigned, bucket_count>> chunk_buckets; // per-chunk bucket counts, then write cursors
+		std::vector<unsigned> chunk_live;							   // per-chunk live path counts, then write cursors
+		std::vector<vec3> radiance;									   // per pixel
+		std::vector<unsigned> tile_offsets;
+		unsigned sample = 0;
+		unsigned bounce = 0;
+	};
+
+	MUU_PURE_GETTER
+	static bool refract(const vec3& v, const vec3& n, float eta, vec3& refracted) noexcept
+	{
+		const auto cos_i  = -vec3::dot(v, n);
+		const auto sin2_t = eta * eta * (1.0f - cos_i * cos_i);
+		if (sin2_t > 1.0f)
+			return false; // total internal reflection
+
+		refracted = eta * v + (eta * cos_i - std::sqrt(1.0f - sin2_t)) * n;
+		return true;
+	}
+
+	MUU_PURE_GETTER
+	static float schlick(float cosine, float ior) noexcept
+	{
+		const auto x = 1.0f - cosine;
+		auto r0		 = (1.0f - ior) / (1.0f + ior);
+		r0			 = r0 * r0;
+		return r0 + (1.0f - r0) * x * x * x * x * x;
+	}
+
+	// one instantiation per material type, so each shading batch runs a single code path with no indirect calls
+	template <material_type Type>
+	MUU_ALWAYS_INLINE
+	static std::optional<ray> MUU_VECTORCALL scatter(const rt::scene& scene,
+													 const ray& r,
+													 const hit_result& hit,
+													 vec3& attenuation) noexcept
+	{
+		const auto& mats = scene.materials;
+		const auto point = r.at(hit.distance);
+
+		if constexpr (Type == material_type::metal)
+		{
+			attenuation = scatter_attenuation(mats, hit.material);
+
+			const auto normal = face_forward(hit.normal, r.direction);
+			vec3 dir		  = reflect(vec3::normalize(r.direction), normal)
+							  + mats.roughness()[hit.material] * random_unit_vector();
+			if (vec3::dot(dir, normal) <= 0.0f)
+				return {};
+
+			return ray{ point, vec3::normalize(dir) };
+		}
+		else if constexpr (is_dielectric(Type))
+		{
+			// for dielectrics the reflectivity column holds the index of refraction
+			attenuation = scatter_attenuation(mats, hit.material);
+
+			const auto ior		= mats.reflectivity()[hit.material];
+			const auto dir		= vec3::normalize(r.direction);
+			const auto entering = vec3::dot(dir, hit.normal) < 0.0f;
+			const auto normal	= entering ? hit.normal : -hit.normal;
+			const auto eta		= entering ? 1.0f / ior : ior;
+			const auto cosine	= std::min(-vec3::dot(dir, normal), 1.0f);
+
+			vec3 refracted;
+			if (refract(dir, normal, eta, refracted) && random<float>() >= schlick(cosine, ior))
+				return ray{ point, vec3::normalize(refracted) };
+
+			return ray{ point, reflect(dir, normal) };
+		}
+		else
+		{
+			// everything else falls back to lambert
+			attenuation = scatter_attenuation(mats, hit.material);
+
+			const auto normal = face_forward(hit.normal, r.direction);
+			auto dir		  = normal + random_unit_vector();
+			if (dir.approx_zero())
+				dir = normal;
+
+			return ray{ point, vec3::normalize(dir) };
+		}
+	}
+
+	using shade_func = void(const rt::scene&, wavefront&, muu::thread_pool&, unsigned, unsigned) noexcept;
+
+	template <material_type Type>
+	static void shade(const rt::scene& scene,
+					  wavefront& wf,
+					  muu::thread_pool& threads,
+					  unsigned begin,
+					  unsigned end) noexcept
+	{
+		// buckets are disjoint so they can all be queued before waiting, hence nothing from this frame is captured
+		threads.for_range(begin,
+						  end,
+						  [&scene, &wf](unsigned i) noexcept
+						  {
+							  const auto index = wf.order[i];
+							  const auto r	   = wf.rays.get_ray(index);
+
+							  seed_random(scene.seed, wf.rays.pixel[index], wf.sample, wf.bounce + 1u);
+
+							  vec3 attenuation;
+							  const auto scattered = scatter<Type>(scene, r, wf.hits.get(index), attenuation);
+							  if (!scattered)
+							  {
+								  wf.alive[index] = 0;
+								  return;
+							  }
+
+							  auto throughput = wf.rays.get_throughput(index) * attenuation;
+							  if (!russian_roulette(throughput, wf.bounce))
+							  {
+								  wf.alive[index] = 0;
+								  return;
+							  }
+
+							  wf.rays.set_ray(index, *scattered);
+							  wf.rays.set_throughput(index, throughput);
+							  wf.alive[index] = 1;
+						  });
+	}
+
+	static constexpr auto shade_funcs = []<size_t... I>(std::index_sequence<I...>) noexcept
+	{
+		return std::array<shade_func*, sizeof...(I)>{ shade<static_cast<material_type>(I)>... };
+	}(std::make_index_sequence<material_type_count>{});
+
+	// keeps a queue of in-flight paths and pushes the whole queue through each stage in turn,
+	// so intersection is batched across rays and shading runs one material type at a time.
+	struct wavefront_path_tracer final : renderer_interface
+	{
+		wavefront wf;
+		tile_scheduler tiles;
+
+		void render(const rt::scene& scene,
+					const frame_settings& settings,
+					image_view& pixels,
+					muu::thread_pool& threads,
+					render_control& control) noexcept override
+		{
+			const auto view		   = settings.camera.viewport(pixels.size());
+			const auto pixel_count = pixels.size().x * pixels.size().y;
+
+			wf.radiance.assign(pixel_count, vec3{});
+			wf.hits.resize(pixel_count);
+			wf.alive.resize(pixel_count);
+			wf.order.resize(pixel_count);
+
+			for (wf.sample = 0; wf.sample < settings.samples_per_pixel; wf.sample++)
+			{
+				// the whole image advances one sample at a time, so that's the granularity cancellation works at
+				if (control.stop_requested())
+					return;
+				control.progress(static_cast<float>(wf.sample) / static_cast<float>(settings.samples_per_pixel));
+
+				generate(scene, view, pixels, threads);
+
+				for (wf.bounce = 0; wf.bounce < scene.max_bounces && wf.rays.size; wf.bounce++)
+				{
+					intersect(scene, threads);
+					sort(threads);
+					shade(scene, threads);
+					compact(threads);
+				}
+			}
+
+			tiles.for_each_pixel(threads,
+								 pixels.size(),
+								 [&](vec2u pos) noexcept
+								 {
+									 auto c = wf.radiance[pos.y * pixels.size().x + pos.x]
+											/ static_cast<float>(settings.samples_per_pixel);
+									 c.x = std::sqrt(c.x);
+									 c.y = std::sqrt(c.y);
+									 c.z = std::sqrt(c.z);
+
+									 pixels(pos) = rt::colour{ c };
+								 });
+			control.progress(1.0f);
+		}
+
+	  private:
+		// primary rays are queued tile by tile, so packets in the intersect stage start out spatially coherent
+		void generate(const rt::scene& scene,
+					  const viewport& view,
+					  const image_view& pixels,
+					  muu::thread_pool& threads) noexcept
+		{
+			const auto sample = wf.sample;
+
+			wf.rays.resize(pixels.size().x * pixels.size().y);
+
+			tiles.resize(pixels.size());
+			const auto tile_list = tiles.tiles();
+			wf.tile_offsets.resize(tile_list.size());
+			unsigned offset = 0;
+			for (size_t i = 0; i < tile_list.size(); i++)
+			{
+				wf.tile_offsets[i] = offset;
+				offset += tile_list[i].size.x * tile_list[i].size.y;
+			}
+
+			tiles.run(threads,
+					  pixels.size(),
+					  [&](const tile& t) noexcept
+					  {
+						  auto slot = wf.tile_offsets[static_cast<size_t>(&t - tile_list.data())];
+						  t.for_each_pixel(
+							  [&](vec2u screen_pos) noexcept
+							  {
+								  const auto pixel_index = screen_pos.y * pixels.size().x + screen_pos.x;
+								  seed_random(scene.seed, pixel_index, sample, 0);
+
+								  const auto pos  = vec2{ screen_pos } + (sample ? random<vec2>() : vec2{ 0.5f });
+								  const auto near = view.screen_to_world(pos, 0.0f);
+								  const auto far  = view.screen_to_world(pos, 1.0f);
+
+								  wf.rays.set_ray(slot, ray{ near, vec3::direction(near, far) });
+								  wf.rays.set_throughput(slot, vec3::constants::one);
+								  wf.rays.pixel[slot] = pixel_index;
+								  slot++;
+							  });
+					  });
+		}
+
+		void intersect(const rt::scene& scene, muu::thread_pool& threads) noexcept
+		{
+			const auto count   = static_cast<unsigned>(wf.rays.size);
+			const auto packets = (count + static_cast<unsigned>(packet_size) - 1u) / static_cast<unsigned>(packet_size);
+
+			threads.for_range(0u,
+							  packets,
+							  [&](unsigned p) noexcept
+							  {
+								  const auto first = p * static_cast<unsigned>(packet_size);
+								  const auto lanes = std::min(count - first, static_cast<unsigned>(packet_size));
+
+								  ray r[packet_size];
+								  for (unsigned i = 0; i < packet_size; i++)
+									  r[i] = wf.rays.get_ray(first + std::min(i, lanes - 1u));
+
+								  hit_result hits[packet_size];
+								  test_packet(scene, ray_packet{ r }, (1u << lanes) - 1u, hits);
+								  flush_ray_count(); // not running in tiles, so tile_scheduler won't do it for us
+
+								  for (unsigned i = 0; i < lanes; i++)
+								  {
+									  const auto& hit = hits[i];
+									  const auto bucket =
+										  hit ? static_cast<size_t>(scene.materials.type()[hit.material]) : miss_bucket;
+									  wf.hits.set(first + i, hit, static_cast<uint8_t>(bucket));
+								  }
+							  });
+			threads.wait();
+		}
+
+		// counting sort of the live rays by the material type they hit
+		void sort(muu::thread_pool& threads) noexcept
+		{
+			const auto count  = static_cast<unsigned>(wf.rays.size);
+			const auto chunks = (count + chunk_size - 1u) / chunk_size;
+			wf.chunk_buckets.resize(chunks);
+
+			threads.for_range(0u,
+							  chunks,
+							  [&](unsigned c) noexcept
+							  {
+								  auto& counts = wf.chunk_buckets[c];
+								  counts	   = {};
+								  for (unsigned i = c * chunk_size, e = std::min(i + chunk_size, count); i < e; i++)
+									  counts[wf.hits.bucket[i]]++;
+							  });
+			threads.wait();
+
+			// bucket-major, so within a bucket the rays keep their queue order
+			unsigned offset = 0;
+			for (size_t b = 0; b < bucket_count; b++)
+			{
+				wf.bucket_offsets[b] = offset;
+				for (auto& counts : wf.chunk_buckets)
+				{
+					const auto n = counts[b];
+					counts[b]	 = offset;
+					offset += n;
+				}
+			}
+			wf.bucket_offsets[bucket_count] = offset;
+
+			threads.for_range(0u,
+							  chunks,
+							  [&](unsigned c) noexcept
+							  {
+								  auto& cursor = wf.chunk_buckets[c];
+								  for (unsigned i = c * chunk_size, e = std::min(i + chunk_size, count); i < e; i++)
+									  wf.order[cursor[wf.hits.bucket[i]]++] = i;
+							  });
+			threads.wait();
+		}
+
+		void shade(const rt::scene& scene, muu::thread_pool& threads) noexcept
+		{
+			for (size_t b = 0; b < material_type_count; b++)
+			{
+				const auto begin = wf.bucket_offsets[b];
+				const auto end	 = wf.bucket_offsets[b + 1u];
+				if (begin != end)
+					shade_funcs[b](scene, wf, threads, begin, end);
+			}
+
+			// each pixel has at most one path in flight, so misses can accumulate without synchronization
+			threads.for_range(wf.bucket_offsets[miss_bucket],
+							  wf.bucket_offsets[miss_bucket + 1u],
+							  [&](unsigned i) noexcept
+							  {
+								  const auto index = wf.order[i];
+								  wf.radiance[wf.rays.pixel[index]] +=
+									  wf.rays.get_throughput(index) * background(wf.rays.get_ray(index));
+								  wf.alive[index] = 0;
+							  });
+			threads.wait();
+		}
+
+		// drops terminated paths from the queue, preserving order so neighbouring pixels stay together
+		void compact(muu::thread_pool& threads) noexcept
+		{
+			const auto count  = static_cast<unsigned>(wf.rays.size);
+			const auto chunks = (count + chunk_size - 1u) / chunk_size;
+			wf.chunk_live.resize(chunks);
+
+			threads.for_range(0u,
+							  chunks,
+							  [&](unsigned c) noexcept
+							  {
+								  unsigned live = 0;
+								  for (unsigned i = c * chunk_size, e = std::min(i + chunk_size, count); i < e; i++)
+									  live += static_cast<unsigned>(wf.alive[i]);
+								  wf.chunk_live[c] = live;
+							  });
+			threads.wait();
+
+			unsigned live = 0;
+			for (auto& cursor : wf.chunk_live)
+			{
+				const auto n = cursor;
+				cursor		 = live;
+				live += n;
+			}
+
+			wf.compacted.resize(live);
+			threads.for_range(0u,
+							  chunks,
+							  [&](unsigned c) noexcept
+							  {
+								  auto to = wf.chunk_live[c];
+								  for (unsigned i = c * chunk_size, e = std::min(i + chunk_size, count); i < e; i++)
+									  if (wf.alive[i])
+										  wf.rays.copy_to(wf.compacted, i, to++);
+							  });
+			threads.wait();
+
+			std::swap(wf.rays, wf.compacted);
+		}
+	};
+
+	REGISTER_RENDERER(wavefront_path_tracer);
+}
@@ -0,0 +1,36 @@
+#include "resolution_scaler.hpp"
+MUU_DISABLE_WARNINGS;
+#include <cmath>
+MUU_ENABLE_WARNINGS;
+
+using namespace rt;
+
+void resolution_scaler::update(float render_time, float area_scale) noexcept
+{
+	if (render_time <= 0.0f || area_scale <= 0.0f || budget <= 0.0f)
+		return;
+
+	// render time is roughly proportional to pixels x samples, so that product is what gets scaled to fit the
+	// budget. the correction is square-rooted and clamped so one noisy frame can't make the resolution jump around.
+	const auto correction = std::sqrt(muu::clamp(budget / render_time, 0.25f, 4.0f));
+	const auto work		  = muu::clamp(area_scale * sample_scale_ * correction, 0.0f, 1.0f);
+
+	const auto min_area = min_scale * min_scale;
+	if (work >= min_area)
+	{
+		scale_		  = std::sqrt(work);
+		sample_scale_ = 1.0f;
+	}
+	else
+	{
+		scale_		  = min_scale;
+		sample_scale_ = muu::max(work / min_area, min_sample_scale);
+	}
+}
+
+MUU_PURE
+vec2u resolution_scaler::apply(vec2u size) const noexcept
+{
+	return vec2u{ muu::max(static_cast<unsigned>(static_cast<float>(size.x) * scale_ + 0.5f), 1u),
+				  muu::max(static_cast<unsigned>(static_cast<float>(size.y) * scale_ + 0.5f), 1u) };
+}
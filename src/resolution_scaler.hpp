@@ -0,0 +1,46 @@
+#pragma once
+#include "common.hpp"
+
+namespace rt
+{
+	// picks the resolution (and, failing that, the sample count) interactive frames are rendered at so they take
+	// roughly a fixed amount of time, using the render times of the frames it has already seen.
+	class resolution_scaler
+	{
+	  private:
+		float scale_		= 0.5f;
+		float sample_scale_ = 1.0f;
+
+	  public:
+		// how long an interactive frame should take to render, in seconds
+		float budget = 1.0f / 30.0f;
+
+		// the smallest fraction of the window's width and height a frame is rendered at.
+		// once the resolution reaches this the sample count is reduced instead.
+		float min_scale = 0.1f;
+
+		// the smallest fraction of the scene's samples-per-pixel a frame is rendered with
+		float min_sample_scale = 1.0f / 64.0f;
+
+		// feeds back the render time of a frame rendered at the given fraction of the full pixel count
+		void update(float render_time, float area_scale) noexcept;
+
+		// returns the size an interactive frame should be rendered at, given the full size
+		MUU_PURE_GETTER
+		vec2u apply(vec2u size) const noexcept;
+
+		// the fraction of the window's width and height interactive frames are rendered at
+		MUU_PURE_INLINE_GETTER
+		float scale() const noexcept
+		{
+			return scale_;
+		}
+
+		// the fraction of the scene's samples-per-pixel interactive frames are rendered with
+		MUU_PURE_INLINE_GETTER
+		float sample_scale() const noexcept
+		{
+			return sample_scale_;
+		}
+	};
+}
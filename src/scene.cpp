@@ -1,4 +1,6 @@
 #include "scene.hpp"
+#include "intersection.hpp"
+#include "random.hpp"
 MUU_DISABLE_WARNINGS;
 #include <toml++/toml.h>
 #include <iostream>
@@ -8,6 +10,11 @@ MUU_DISABLE_WARNINGS;
 #include <filesystem>
 #include <optional>
 #include <array>
+#include <vector>
+#include <span>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <muu/type_name.h>
 #include <muu/hashing.h>
 #include <magic_enum.hpp>
@@ -476,11 +483,577 @@ namespace
 		return deserialize_if(get(parent, key), T{ val });
 	}
 
+	template <typename Table, size_t... Columns>
+	static void reorder_rows(Table& table, std::span<const uint32_t> order, std::index_sequence<Columns...>)
+	{
+		Table sorted;
+		sorted.reserve(table.size());
+		for (const auto i : order)
+			sorted.push_back(table.template column<Columns>()[i]...);
+		table = std::move(sorted);
+	}
+
+	template <typename Table>
+	static void reorder_rows(Table& table, std::span<const uint32_t> order)
+	{
+		assert(order.size() == table.size());
+
+		reorder_rows(table, order, std::make_index_sequence<Table::column_count>{});
+	}
+
+	template <typename Table, size_t... Columns>
+	static void append_rows(Table& dest, const Table& src, size_t first, size_t count, std::index_sequence<Columns...>)
+	{
+		for (auto i = first, e = first + count; i < e; i++)
+			dest.push_back(src.template column<Columns>()[i]...);
+	}
+
+	template <typename Table>
+	static void append_rows(Table& dest, const Table& src, size_t first, size_t count)
+	{
+		assert(first + count <= src.size());
+
+		append_rows(dest, src, first, count, std::make_index_sequence<Table::column_count>{});
+	}
+
+	// the simd kernels load whole batches, so the last batch of a table reads up to simd_padding rows past its end.
+	// those rows are pushed as zeroes and then dropped again, which leaves the memory past size() initialised without
+	// making the padding visible to anything that iterates the table (see scene.hpp for what that rules out).
+	template <typename Table, size_t... Columns>
+	static void zero_simd_padding(Table& table, std::index_sequence<Columns...>)
+	{
+		const auto rows = table.size();
+		table.reserve(rows + simd_padding);
+		for (size_t i = 0; i < simd_padding; i++)
+			table.push_back(typename Table::template column_type<Columns>{}...);
+		table.resize(rows);
+	}
+
+	template <typename Table>
+	static void zero_simd_padding(Table& table)
+	{
+		zero_simd_padding(table, std::make_index_sequence<Table::column_count>{});
+	}
+
+	// strings (i.e. material names) are skipped since they don't affect what anything looks like
+	template <typename Table, size_t... Columns>
+	static void hash_rows(muu::fnv1a<64>& hasher, const Table& table, std::index_sequence<Columns...>)
+	{
+		const auto hash_column = [&](const auto* column) noexcept
+		{
+			using value_type = std::remove_cvref_t<decltype(*column)>;
+			if constexpr (std::is_trivially_copyable_v<value_type>)
+				hasher(std::string_view{ reinterpret_cast<const char*>(column), table.size() * sizeof(value_type) });
+		};
+		(hash_column(table.template column<Columns>()), ...);
+	}
+
+	template <typename Table>
+	static void hash_rows(muu::fnv1a<64>& hasher, const Table& table)
+	{
+		hash_rows(hasher, table, std::make_index_sequence<Table::column_count>{});
+	}
+
+	MUU_NODISCARD
+	static uint64_t hash_content(const scene& s)
+	{
+		muu::fnv1a<64> hasher;
+		hash_rows(hasher, s.materials);
+		hash_rows(hasher, s.planes);
+		hash_rows(hasher, s.spheres);
+		hash_rows(hasher, s.boxes);
+		hash_rows(hasher, s.triangles);
+		hasher(std::string_view{ reinterpret_cast<const char*>(s.instances.data()),
+								 s.instances.size() * sizeof(instance) });
+
+		const uint64_t settings[] = { s.samples_per_pixel, s.max_bounces, s.seed.has_value(), s.seed.value_or(0u) };
+		hasher(std::string_view{ reinterpret_cast<const char*>(settings), sizeof(settings) });
+
+		// every member of adaptive_sampling changes which samples get taken, so it's hashed whole
+		static_assert(std::is_trivially_copyable_v<adaptive_sampling>);
+		static_assert(sizeof(adaptive_sampling) == sizeof(float) + sizeof(unsigned) * 2u, "unexpected padding");
+		hasher(std::string_view{ reinterpret_cast<const char*>(&s.adaptive), sizeof(s.adaptive) });
+		return hasher.value();
+	}
+
+	// builds a bvh over the given bounds, returning the order the primitives need to be stored in (see bvh::build()).
+	// given the bvh from a previous load of the scene with the same number of primitives, that bvh is refitted to
+	// the new bounds and its order kept, so reloads only pay for a full rebuild if things have moved a long way.
+	// the refit only recomputes the leaves whose primitives actually moved and their ancestors (see bvh::refit()).
+	MUU_NODISCARD
+	static std::vector<uint32_t> build_or_refit(bvh& tree,
+												std::span<const box> bounds,
+												const bvh* previous,
+												std::span<const uint32_t> previous_order)
+	{
+		if (previous && !previous->empty() && previous_order.size() == bounds.size())
+		{
+			std::vector<box> ordered;
+			ordered.reserve(bounds.size());
+			for (const auto i : previous_order)
+				ordered.push_back(bounds[i]);
+
+			tree = *previous;
+			if (tree.refit(ordered))
+				return { previous_order.begin(), previous_order.end() };
+		}
+
+		return tree.build(bounds);
+	}
+
+	static void build_primitive_bvh(scene& s, const scene* previous)
+	{
+		const auto sphere_count = s.spheres.size();
+
+		std::vector<box> bounds;
+		bounds.reserve(sphere_count + s.boxes.size());
+		for (const auto& sphere : std::span{ s.spheres.value(), sphere_count })
+			bounds.push_back(box{ sphere.center, vec3{ sphere.radius } });
+		for (const auto& bb : std::span{ s.boxes.value(), s.boxes.size() })
+			bounds.push_back(bb);
+
+		// the previous order can only be reused if it splits the same way into spheres and boxes
+		if (previous && previous->spheres.size() == sphere_count && previous->boxes.size() == s.boxes.size())
+			s.primitive_order =
+				build_or_refit(s.primitive_bvh, bounds, &previous->primitive_bvh, previous->primitive_order);
+		else
+			s.primitive_order = s.primitive_bvh.build(bounds);
+		const auto& order = s.primitive_order;
+
+		// leaves reference contiguous row ranges, so both tables need to be stored in the order the bvh wants
+		std::vector<uint32_t> sphere_order;
+		std::vector<uint32_t> box_order;
+		sphere_order.reserve(sphere_count);
+		box_order.reserve(s.boxes.size());
+		s.spheres_before.clear();
+		s.spheres_before.reserve(order.size() + 1u);
+		s.spheres_before.push_back(0u);
+		for (const auto i : order)
+		{
+			if (i < sphere_count)
+				sphere_order.push_back(i);
+			else
+				box_order.push_back(static_cast<uint32_t>(i - sphere_count));
+			s.spheres_before.push_back(static_cast<uint32_t>(sphere_order.size()));
+		}
+
+		reorder_rows(s.spheres, sphere_order);
+		reorder_rows(s.boxes, box_order);
+	}
+
+	struct transform
+	{
+		mat3 linear = mat3::constants::identity; // rotation and scale
+		vec3 position;
+	};
+
+	// euler angles are in radians and applied x first, then y, then z
+	MUU_PURE_GETTER
+	static mat3 make_linear(const vec3& angles, const vec3& scale) noexcept
+	{
+		const auto rotation = mat3::from_axis_angle(vec3::constants::z_axis, angles.z)
+							* mat3::from_axis_angle(vec3::constants::y_axis, angles.y)
+							* mat3::from_axis_angle(vec3::constants::x_axis, angles.x);
+		return rotation * mat3{ scale.x, 0.0f, 0.0f, 0.0f, scale.y, 0.0f, 0.0f, 0.0f, scale.z };
+	}
+
+	// reads the optional position, rotation (euler angles in degrees) and scale keys of a mesh or instance
+	static transform get_transform(const toml::node& tbl)
+	{
+		const auto position = deserialize(tbl, "position", vec3{});
+		const auto angles	= deserialize(tbl, "rotation", vec3{}) * (floats::pi / 180.0f);
+		const auto scale	= deserialize(tbl, "scale", vec3{ 1.0f });
+		if (muu::abs(scale.x) < 1e-6f || muu::abs(scale.y) < 1e-6f || muu::abs(scale.z) < 1e-6f)
+			error(tbl, "'scale' must not have any zero components"sv);
+
+		return transform{ .linear = make_linear(angles, scale), .position = position };
+	}
+
+	// loads the file named by a table's 'path' key into the scene's triangle table.
+	// relative paths are resolved against the directory containing the scene file.
+	// previous is the same list (meshes or objects) from the previous load of the scene, if any.
+	static rt::mesh load_mesh_rows(scene& s,
+								   const toml::node& tbl,
+								   const transform& xform,
+								   unsigned material,
+								   const scene* previous,
+								   std::span<const rt::mesh> previous_meshes)
+	{
+		std::string path_str;
+		deserialize(*get(tbl, "path", true), path_str);
+		fs::path path{ path_str };
+		path.make_preferred();
+		if (path.is_relative() && !s.path.empty())
+			path = fs::path{ s.path }.parent_path() / path;
+
+		std::error_code write_time_error;
+		const auto write_time = fs::last_write_time(path, write_time_error);
+
+		// if the file and its placement are the same as last time, the rows and bvh can be copied as-is
+		if (previous && !write_time_error)
+		{
+			for (const auto& prev : previous_meshes)
+			{
+				if (prev.path != path.string() || prev.write_time != write_time || prev.linear != xform.linear
+					|| prev.position != xform.position)
+					continue;
+
+				auto m	= prev;
+				m.first = static_cast<uint32_t>(s.triangles.size());
+				s.triangles.reserve(s.triangles.size() + m.count);
+				append_rows(s.triangles, previous->triangles, prev.first, prev.count);
+				std::fill_n(s.triangles.material() + m.first, m.count, material);
+				return m;
+			}
+		}
+
+		mesh_data data;
+		try
+		{
+			data = rt::load_mesh(path.string());
+		}
+		catch (const std::exception& ex)
+		{
+			error(tbl, ex.what());
+		}
+
+		for (auto& v : data.vertices)
+			v = xform.linear * v + xform.position;
+
+		// the bvh (and everything downstream of it) indexes triangles with 32-bit integers
+		const auto count = data.indices.size() / 3u;
+		if (s.triangles.size() + count + simd_padding > std::numeric_limits<uint32_t>::max())
+			error(tbl, "too many triangles"sv);
+
+		std::vector<box> bounds;
+		bounds.reserve(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			const auto& a  = data.vertices[data.indices[i * 3u]];
+			const auto& b  = data.vertices[data.indices[i * 3u + 1u]];
+			const auto& c  = data.vertices[data.indices[i * 3u + 2u]];
+			const auto min = vec3::min(vec3::min(a, b), c);
+			const auto max = vec3::max(vec3::max(a, b), c);
+			bounds.push_back(box{ (min + max) * 0.5f, (max - min) * 0.5f });
+		}
+
+		rt::mesh m;
+		m.path		 = path.string();
+		m.first		 = static_cast<uint32_t>(s.triangles.size());
+		m.count		 = static_cast<uint32_t>(count);
+		m.write_time = write_time;
+		m.linear	 = xform.linear;
+		m.position	 = xform.position;
+
+		// rows are written in the order the bvh wants so each leaf is a contiguous range, same as the spheres.
+		// the edges are stored instead of the other two vertices because that's what moller-trumbore wants.
+		s.triangles.reserve(s.triangles.size() + count);
+		for (const auto i : m.bvh.build(bounds))
+		{
+			const auto& a = data.vertices[data.indices[i * 3u]];
+			const auto e1 = data.vertices[data.indices[i * 3u + 1u]] - a;
+			const auto e2 = data.vertices[data.indices[i * 3u + 2u]] - a;
+			s.triangles.push_back(material, a.x, a.y, a.z, e1.x, e1.y, e1.z, e2.x, e2.y, e2.z);
+		}
+
+		return m;
+	}
+
+	// objects can be referred to by name or by index
+	static uint32_t get_object(const scene& s, const toml::node& parent)
+	{
+		const auto node = get(parent, "object", true);
+		if (const auto name = node->as_string())
+		{
+			for (size_t i = 0; i < s.objects.size(); i++)
+				if (s.objects[i].name == **name)
+					return static_cast<uint32_t>(i);
+			error(*node, "no object named '"sv, **name, "'"sv);
+		}
+
+		unsigned index{};
+		deserialize(*node, index);
+		if (index >= s.objects.size())
+			error(*node, "object index "sv, index, " out-of-range");
+		return index;
+	}
+
+	static void add_instance(scene& s, uint32_t object, const transform& xform, unsigned material)
+	{
+		s.instances.push_back(instance{ .to_world  = xform.linear,
+										.to_object = mat3::invert(xform.linear),
+										.position  = xform.position,
+										.object	   = object,
+										.material  = material });
+	}
+
+	static void build_instance_bvh(scene& s, const scene* previous)
+	{
+		std::vector<box> bounds;
+		bounds.reserve(s.instances.size());
+		for (const auto& inst : s.instances)
+		{
+			// the root node of the object's bvh bounds all of its triangles, so its corners bound the instance
+			const auto& root = s.objects[inst.object].bvh.nodes()[0];
+			auto min		 = vec3{ floats::highest };
+			auto max		 = vec3{ floats::lowest };
+			for (unsigned corner = 0; corner < 8u; corner++)
+			{
+				const auto p = inst.to_world
+								 * vec3{ corner & 1u ? root.max.x : root.min.x,
+										 corner & 2u ? root.max.y : root.min.y,
+										 corner & 4u ? root.max.z : root.min.z }
+							 + inst.position;
+				min = vec3::min(min, p);
+				max = vec3::max(max, p);
+			}
+			bounds.push_back(box{ (min + max) * 0.5f, (max - min) * 0.5f });
+		}
+
+		if (previous)
+			s.instance_order =
+				build_or_refit(s.instance_bvh, bounds, &previous->instance_bvh, previous->instance_order);
+		else
+			s.instance_order = s.instance_bvh.build(bounds);
+
+		std::vector<instance> sorted;
+		sorted.reserve(s.instances.size());
+		for (const auto i : s.instance_order)
+			sorted.push_back(s.instances[i]);
+		s.instances = std::move(sorted);
+	}
+
+	enum class generated_primitive : unsigned
+	{
+		spheres,
+		boxes,
+		planes,
+		instances,
+	};
+
+	enum class generated_distribution : unsigned
+	{
+		uniform,   // anywhere inside the bounds
+		clustered, // around randomly-placed cluster centers
+		grid,	   // one per cell of a regular lattice filling the bounds
+	};
+
+	static constexpr unsigned max_generated_count = 10'000'000u;
+
+	struct generator_random
+	{
+		pcg32 engine;
+
+		MUU_ALWAYS_INLINE
+		float range(float lo, float hi) noexcept
+		{
+			return lo + (hi - lo) * engine.next_float();
+		}
+
+		// components are drawn in a fixed order so a given seed always produces the same scene
+		MUU_ALWAYS_INLINE
+		vec3 point(const vec3& lo, const vec3& hi) noexcept
+		{
+			const auto x = range(lo.x, hi.x);
+			const auto y = range(lo.y, hi.y);
+			const auto z = range(lo.z, hi.z);
+			return vec3{ x, y, z };
+		}
+
+		MUU_ALWAYS_INLINE
+		unsigned index(unsigned count) noexcept
+		{
+			return static_cast<unsigned>((uint64_t{ engine.next_uint() } * count) >> 32);
+		}
+
+		// roughly normal in [-1, 1]
+		MUU_ALWAYS_INLINE
+		float bell() noexcept
+		{
+			const auto a = range(-1.0f, 1.0f);
+			const auto b = range(-1.0f, 1.0f);
+			const auto c = range(-1.0f, 1.0f);
+			return (a + b + c) / 3.0f;
+		}
+	};
+
+	static void generate_materials(scene& s, generator_random& rng, unsigned count)
+	{
+		s.materials.reserve(s.materials.size() + count);
+		for (unsigned i = 0; i < count; i++)
+		{
+			const auto roll = rng.engine.next_float();
+			const auto r	= rng.range(0.1f, 1.0f);
+			const auto g	= rng.range(0.1f, 1.0f);
+			const auto b	= rng.range(0.1f, 1.0f);
+
+			if (roll < 0.6f)
+				s.materials.push_back(""s, material_type::lambert, colour{ r, g, b }, 0.5f, 0.5f);
+			else if (roll < 0.85f)
+				s.materials.push_back(""s, material_type::metal, colour{ r, g, b }, rng.range(0.0f, 0.3f), 0.8f);
+			else
+				s.materials.push_back(""s, material_type::dielectric, colour{ r, g, b }, 0.0f, 1.52f);
+		}
+	}
+
+	// handles one [[generate]] table. primitives are written straight into the scene's tables,
+	// so scenes with millions of primitives don't have to exist as (or be parsed from) toml.
+	// has_materials is whether the scene file defined any materials (as opposed to just getting the fallback one).
+	static void generate_primitives(scene& s, const toml::node& tbl, unsigned directive, bool has_materials)
+	{
+		const auto type			= deserialize(tbl, "type", generated_primitive::spheres);
+		const auto distribution = deserialize(tbl, "distribution", generated_distribution::uniform);
+		const auto count		= muu::clamp(deserialize(tbl, "count", 1000u), 0u, max_generated_count);
+		const auto lo			= deserialize(tbl, "min", vec3{ -50, 0, -50 });
+		const auto hi			= deserialize(tbl, "max", vec3{ 50, 10, 50 });
+		const auto size			= deserialize(tbl, "size", vec2{ 0.1f, 0.5f });
+		if (hi.x < lo.x || hi.y < lo.y || hi.z < lo.z)
+			error(tbl, "generator bounds 'max' must not be less than 'min'"sv);
+		if (size.x <= 0.0f || size.y < size.x)
+			error(tbl, "generator 'size' must be a positive [min, max] range"sv);
+
+		generator_random rng{ pcg32{ deserialize(tbl, "seed", uint64_t{}), directive } };
+
+		// each directive gets its own palette by default. with materials = 0 the scene's materials are used instead.
+		auto first_material = 0u;
+		auto material_count = static_cast<unsigned>(s.materials.size());
+		if (const auto new_materials = muu::clamp(deserialize(tbl, "materials", 16u), 0u, 1024u))
+		{
+			first_material = material_count;
+			material_count = new_materials;
+			generate_materials(s, rng, new_materials);
+		}
+		else if (!has_materials)
+			error(tbl, "generator 'materials' can only be 0 if the scene defines materials of its own"sv);
+
+		std::vector<vec3> clusters;
+		const auto cluster_radius = deserialize(tbl, "cluster_radius", vec3::length(hi - lo) * 0.05f);
+		if (distribution == generated_distribution::clustered)
+		{
+			clusters.resize(muu::clamp(deserialize(tbl, "clusters", 16u), 1u, count ? count : 1u));
+			for (auto& c : clusters)
+				c = rng.point(lo, hi);
+		}
+
+		// grid cells are roughly cubic, so flat bounds get a flat lattice rather than a squashed one
+		const auto grid_extents = vec3::max(hi - lo, vec3{ 0.0001f });
+		const auto grid_volume	= grid_extents.x * grid_extents.y * grid_extents.z;
+		auto grid_spacing		= std::cbrt(grid_volume / static_cast<float>(count ? count : 1u));
+		vec3u grid_cells;
+		while (true)
+		{
+			for (size_t i = 0; i < 3u; i++)
+				grid_cells[i] = std::max(static_cast<unsigned>(std::ceil(grid_extents[i] / grid_spacing)), 1u);
+			if (uint64_t{ grid_cells.x } * grid_cells.y * grid_cells.z >= count)
+				break;
+			grid_spacing *= 0.99f;
+		}
+		const auto grid_step   = grid_extents / vec3{ grid_cells };
+		const auto grid_jitter = muu::clamp(deserialize(tbl, "jitter", 0.0f), 0.0f, 1.0f);
+
+		const auto next_position = [&](unsigned i) noexcept -> vec3
+		{
+			switch (distribution)
+			{
+				case generated_distribution::clustered:
+				{
+					const auto& center = clusters[rng.index(static_cast<unsigned>(clusters.size()))];
+					const auto x	   = rng.bell();
+					const auto y	   = rng.bell();
+					const auto z	   = rng.bell();
+					return center + vec3{ x, y, z } * cluster_radius;
+				}
+
+				case generated_distribution::grid:
+				{
+					const auto cell = vec3{ static_cast<float>(i % grid_cells.x),
+											static_cast<float>((i / grid_cells.x) % grid_cells.y),
+											static_cast<float>(i / (grid_cells.x * grid_cells.y)) };
+					const auto offset = rng.point(vec3{ -0.5f }, vec3{ 0.5f }) * grid_jitter;
+					return lo + (cell + vec3{ 0.5f } + offset) * grid_step;
+				}
+
+				default: return rng.point(lo, hi);
+			}
+		};
+
+		switch (type)
+		{
+			case generated_primitive::spheres:
+			{
+				s.spheres.reserve(s.spheres.size() + count);
+				for (unsigned i = 0; i < count; i++)
+				{
+					const auto center	= next_position(i);
+					const auto radius	= rng.range(size.x, size.y);
+					const auto material = first_material + rng.index(material_count);
+					s.spheres.push_back(rt::sphere{ center, radius }, material, center.x, center.y, center.z, radius);
+				}
+				break;
+			}
+
+			case generated_primitive::boxes:
+			{
+				s.boxes.reserve(s.boxes.size() + count);
+				for (unsigned i = 0; i < count; i++)
+				{
+					const auto center	= next_position(i);
+					const auto extents	= rng.point(vec3{ size.x }, vec3{ size.y });
+					const auto material = first_material + rng.index(material_count);
+					s.boxes.push_back(rt::box{ center, extents },
+									  material,
+									  center.x,
+									  center.y,
+									  center.z,
+									  extents.x,
+									  extents.y,
+									  extents.z);
+				}
+				break;
+			}
+
+			case generated_primitive::planes:
+			{
+				s.planes.reserve(s.planes.size() + count);
+				for (unsigned i = 0; i < count; i++)
+				{
+					const auto position = next_position(i);
+
+					auto normal = rng.point(vec3{ -1.0f }, vec3{ 1.0f });
+					while (vec3::length_squared(normal) < 0.0001f)
+						normal = rng.point(vec3{ -1.0f }, vec3{ 1.0f });
+
+					const auto plane	= rt::plane{ position, vec3::normalize(normal) };
+					const auto material = first_material + rng.index(material_count);
+					s.planes.push_back(plane, material, plane.normal.x, plane.normal.y, plane.normal.z, plane.d);
+				}
+				break;
+			}
+
+			// e.g. a forest: one object's triangles, any number of randomly turned and scaled copies
+			case generated_primitive::instances:
+			{
+				const auto object = get_object(s, tbl);
+				s.instances.reserve(s.instances.size() + count);
+				for (unsigned i = 0; i < count; i++)
+				{
+					const auto position = next_position(i);
+					const auto yaw		= rng.range(0.0f, floats::two_pi);
+					const auto scale	= rng.range(size.x, size.y);
+					const auto material = first_material + rng.index(material_count);
+					const auto linear	= make_linear(vec3{ 0.0f, yaw, 0.0f }, vec3{ scale });
+					add_instance(s, object, transform{ linear, position }, material);
+				}
+				break;
+			}
+		}
+	}
+
 	static constexpr auto path_search_prefixes =
 		std::array{ "scenes/"sv, "../scenes/"sv, "../../scenes/"sv, ""sv, "../"sv, "../../"sv };
 }
 
-scene scene::load(std::string_view path_sv)
+scene scene::load(std::string_view path_sv, const scene* previous)
 {
 	if (path_sv.empty())
 		throw std::runtime_error{ "no scene file path provided" };
@@ -530,6 +1103,20 @@ scene scene::load(std::string_view path_sv)
 
 	s.samples_per_pixel = muu::clamp(deserialize(config, "samples_per_pixel", 30u), 1u, 1000u);
 	s.max_bounces		= muu::clamp(deserialize(config, "max_bounces", 10u), 1u, 1000u);
+	if (const auto seed = get(config, "seed"))
+	{
+		uint64_t val{};
+		s.seed = deserialize(*seed, val);
+	}
+
+	if (auto adaptive = get_table(config, "adaptive"))
+	{
+		auto& settings		 = s.adaptive;
+		settings.threshold	 = muu::clamp(deserialize(*adaptive, "threshold", 0.05f), 0.0f, 1.0f);
+		settings.min_samples = muu::clamp(deserialize(*adaptive, "min_samples", 16u), 2u, 1000u);
+		settings.max_samples =
+			muu::clamp(deserialize(*adaptive, "max_samples", s.samples_per_pixel), settings.min_samples, 100000u);
+	}
 
 	if (auto camera = get_table(config, "camera"))
 	{
@@ -562,7 +1149,8 @@ scene scene::load(std::string_view path_sv)
 								  deserialize(tbl, "reflectivity", reflectiveness));
 		}
 	}
-	if (s.materials.empty())
+	const auto has_materials = !s.materials.empty();
+	if (!has_materials)
 		s.materials.push_back(""s, material_type::lambert, colours::fuchsia, 0.05f, 0.5f);
 
 	const auto get_material = [&](const toml::node& parent) -> unsigned
@@ -614,10 +1202,63 @@ scene scene::load(std::string_view path_sv)
 		}
 	}
 
+	// unchanged mesh files are copied from the previous load rather than read and rebuilt
+	const auto previous_of = [&](std::vector<rt::mesh> scene::*list) noexcept
+	{ return previous ? std::span<const rt::mesh>{ previous->*list } : std::span<const rt::mesh>{}; };
+
+	if (auto meshes = get_array(config, "meshes"))
+	{
+		for (auto& tbl : *meshes)
+		{
+			const auto xform = get_transform(tbl);
+			s.meshes.push_back(
+				load_mesh_rows(s, tbl, xform, get_material(tbl), previous, previous_of(&scene::meshes)));
+		}
+	}
+
+	// objects are only loaded once, however many instances there are of them.
+	// their triangles' material column goes unused; each instance supplies its own.
+	if (auto objects = get_array(config, "objects"))
+	{
+		for (auto& tbl : *objects)
+		{
+			auto name = deserialize(tbl, "name", ""s);
+			if (!name.empty()
+				&& std::any_of(s.objects.begin(), s.objects.end(), [&](const rt::mesh& m) { return m.name == name; }))
+				error(tbl, "object name '"sv, name, "' is already in use"sv);
+
+			auto& obj =
+				s.objects.emplace_back(load_mesh_rows(s, tbl, transform{}, 0u, previous, previous_of(&scene::objects)));
+			obj.name  = std::move(name);
+		}
+	}
+
+	if (auto instances = get_array(config, "instances"))
+	{
+		for (auto& tbl : *instances)
+			add_instance(s, get_object(s, tbl), get_transform(tbl), get_material(tbl));
+	}
+
+	if (auto generators = get_array(config, "generate"))
+	{
+		unsigned directive = 0;
+		for (auto& tbl : *generators)
+			generate_primitives(s, tbl, directive++, has_materials);
+	}
+
+	build_primitive_bvh(s, previous);
+	build_instance_bvh(s, previous);
+
+	zero_simd_padding(s.planes);
+	zero_simd_padding(s.spheres);
+	zero_simd_padding(s.boxes);
+	zero_simd_padding(s.triangles);
+
+	s.content_hash = hash_content(s);
 	return s;
 }
 
-scene scene::load_first_available()
+scene scene::load_first_available(const scene* previous)
 {
 	for (const auto& dir_sv : path_search_prefixes)
 	{
@@ -635,9 +1276,35 @@ scene scene::load_first_available()
 			if (status.type() != fs::file_type::regular)
 				continue;
 
-			return load(file.path().string());
+			return load(file.path().string(), previous);
 		}
 	}
 
 	throw std::runtime_error{ "no scene files found" };
 }
+
+std::vector<std::string> scene::find_all()
+{
+	std::vector<std::string> paths;
+	for (const auto& dir_sv : path_search_prefixes)
+	{
+		fs::path dir{ dir_sv };
+		if (fs::status(dir).type() != fs::file_type::directory)
+			continue;
+
+		for (auto const& file : fs::directory_iterator{ dir })
+		{
+			if (!file.path().has_stem() || !file.path().has_extension() || file.path().extension() != ".toml"sv)
+				continue;
+
+			if (fs::status(file).type() == fs::file_type::regular)
+				paths.push_back(file.path().string());
+		}
+
+		if (!paths.empty())
+			break;
+	}
+
+	std::sort(paths.begin(), paths.end());
+	return paths;
+}
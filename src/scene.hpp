@@ -2,25 +2,87 @@
 #include "common.hpp"
 #include "camera.hpp"
 #include "soa.hpp"
+#include "triangles.hpp"
+#include "bvh.hpp"
+#include "mesh.hpp"
+#include "adaptive_sampling.hpp"
+MUU_DISABLE_WARNINGS;
+#include <optional>
+#include <vector>
+#include <string>
+MUU_ENABLE_WARNINGS;
 
 namespace rt
 {
+	// the parts of a scene that can change from one frame to the next without reloading it (e.g. the camera being
+	// moved interactively, or fewer samples while it's moving). renderers take them from here, not from the scene.
+	struct frame_settings
+	{
+		rt::camera camera;
+		unsigned samples_per_pixel = 30;
+		rt::adaptive_sampling adaptive;
+
+		// the most samples any one pixel will receive
+		MUU_PURE_INLINE_GETTER
+		unsigned max_samples_per_pixel() const noexcept
+		{
+			return adaptive ? adaptive.max_samples : samples_per_pixel;
+		}
+	};
+
 	struct scene
 	{
 		unsigned samples_per_pixel = 30;
 		unsigned max_bounces	   = 10;
+		std::optional<uint64_t> seed; // set to render deterministically
+		rt::adaptive_sampling adaptive;
 
 		std::string path;
 		rt::camera camera;
 		rt::materials materials;
+
+		// the simd kernels read up to simd_padding rows past the end of these, so load() leaves that much zeroed memory
+		// after the last row of each. anything that adds rows afterwards can reallocate and lose it, so they must not be
+		// grown once load() has returned (moving a scene is fine; the storage moves with it).
 		rt::planes planes;
 		rt::spheres spheres;
 		rt::boxes boxes;
+		rt::triangles triangles;
+
+		// spheres and boxes share one bvh, and both tables are stored in its order.
+		// spheres_before[i] is the number of spheres among the first i primitives in that order.
+		rt::bvh primitive_bvh;
+		std::vector<uint32_t> primitive_order; // source index of each primitive in bvh order (see bvh::build())
+		std::vector<uint32_t> spheres_before;
+
+		std::vector<rt::mesh> meshes;  // placed in world space when loaded
+		std::vector<rt::mesh> objects; // in their own space, only reachable through instances
+		std::vector<rt::instance> instances;
+		rt::bvh instance_bvh;
+		std::vector<uint32_t> instance_order;
+
+		// a hash of everything that affects the rendered image except the camera (which reloading doesn't touch),
+		// so a reload can tell whether anything visible actually changed
+		uint64_t content_hash = 0;
+
+		// the scene's own camera and sampling settings, for frames that don't override any of them
+		MUU_PURE_INLINE_GETTER
+		frame_settings settings() const noexcept
+		{
+			return { .camera = camera, .samples_per_pixel = samples_per_pixel, .adaptive = adaptive };
+		}
+
+		// if a previously-loaded scene is given, anything that hasn't changed since is copied from it rather than
+		// being rebuilt (mesh files aren't read again, bvhs are refitted instead of rebuilt where possible, etc.).
+		// the previous scene is only read from, so it's fine for it to still be in use by a renderer.
+		MUU_NODISCARD
+		static scene load(std::string_view file, const scene* previous = nullptr);
 
 		MUU_NODISCARD
-		static scene load(std::string_view file);
+		static scene load_first_available(const scene* previous = nullptr);
 
+		// paths of every scene file in the first directory that has any, sorted by name
 		MUU_NODISCARD
-		static scene load_first_available();
+		static std::vector<std::string> find_all();
 	};
 }
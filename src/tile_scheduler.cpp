@@ -0,0 +1,76 @@
+#include "tile_scheduler.hpp"
+#include "intersection.hpp"
+MUU_DISABLE_WARNINGS;
+#include <algorithm>
+MUU_ENABLE_WARNINGS;
+
+using namespace rt;
+
+namespace
+{
+	// interleaves the low 16 bits of x with zeroes
+	MUU_CONST_INLINE_GETTER
+	static uint32_t spread_bits(uint32_t x) noexcept
+	{
+		x &= 0x0000FFFFu;
+		x = (x | (x << 8)) & 0x00FF00FFu;
+		x = (x | (x << 4)) & 0x0F0F0F0Fu;
+		x = (x | (x << 2)) & 0x33333333u;
+		x = (x | (x << 1)) & 0x55555555u;
+		return x;
+	}
+
+	MUU_CONST_INLINE_GETTER
+	static uint32_t morton_code(uint32_t x, uint32_t y) noexcept
+	{
+		return spread_bits(x) | (spread_bits(y) << 1);
+	}
+}
+
+tile_scheduler::tile_scheduler(unsigned tile_size) noexcept //
+	: tile_size_{ std::max(tile_size, 1u) }
+{}
+
+void tile_scheduler::resize(vec2u image_size)
+{
+	if (image_size == image_size_)
+		return;
+
+	image_size_ = image_size;
+	tiles_.clear();
+	if (!image_size.x || !image_size.y)
+		return;
+
+	const auto columns = (image_size.x + tile_size_ - 1u) / tile_size_;
+	const auto rows	   = (image_size.y + tile_size_ - 1u) / tile_size_;
+	tiles_.reserve(columns * rows);
+
+	for (unsigned y = 0; y < rows; y++)
+	{
+		for (unsigned x = 0; x < columns; x++)
+		{
+			const auto start = vec2u{ x, y } * tile_size_;
+			tiles_.push_back(tile{ start,
+								   vec2u{ std::min(tile_size_, image_size.x - start.x),
+										  std::min(tile_size_, image_size.y - start.y) } });
+		}
+	}
+
+	std::sort(tiles_.begin(),
+			  tiles_.end(),
+			  [&](const tile& lhs, const tile& rhs) noexcept
+			  {
+				  return morton_code(lhs.start.x / tile_size_, lhs.start.y / tile_size_)
+					   < morton_code(rhs.start.x / tile_size_, rhs.start.y / tile_size_);
+			  });
+}
+
+unsigned tile_scheduler::slot_count(const muu::thread_pool& threads) noexcept
+{
+	return std::max(static_cast<unsigned>(threads.workers()), 1u);
+}
+
+void tile_scheduler::finish_tile() noexcept
+{
+	flush_ray_count();
+}
@@ -0,0 +1,136 @@
+#pragma once
+#include "common.hpp"
+#include "renderer.hpp"
+MUU_DISABLE_WARNINGS;
+#include <muu/thread_pool.h>
+#include <atomic>
+#include <vector>
+#include <span>
+MUU_ENABLE_WARNINGS;
+
+namespace rt
+{
+	struct tile
+	{
+		vec2u start;
+		vec2u size;
+
+		template <typename Func>
+		MUU_ALWAYS_INLINE
+		void for_each_pixel(Func&& func) const
+		{
+			for (unsigned y = start.y, ey = start.y + size.y; y < ey; y++)
+				for (unsigned x = start.x, ex = start.x + size.x; x < ex; x++)
+					func(vec2u{ x, y });
+		}
+	};
+
+	// splits an image into square tiles and hands them out in morton order, so the tiles being worked on at any one
+	// time are close together in the image. workers keep pulling tiles from a shared counter until none are left,
+	// which balances cheap regions (e.g. sky) against expensive ones without any up-front partitioning.
+	class tile_scheduler
+	{
+	  public:
+		static constexpr unsigned default_tile_size = 16;
+
+	  private:
+		std::vector<tile> tiles_;
+		vec2u image_size_	= {};
+		unsigned tile_size_ = default_tile_size;
+
+	  public:
+		MUU_NODISCARD_CTOR
+		explicit tile_scheduler(unsigned tile_size = default_tile_size) noexcept;
+
+		// regenerates the tile list if the image size has changed since the last call
+		void resize(vec2u image_size);
+
+		MUU_PURE_INLINE_GETTER
+		std::span<const tile> tiles() const noexcept
+		{
+			return { tiles_.data(), tiles_.size() };
+		}
+
+		// the number of scratch slots run() hands out. a slot is only ever used by one thread at a time,
+		// so renderers can keep per-slot scratch state without synchronization.
+		MUU_PURE_GETTER
+		static unsigned slot_count(const muu::thread_pool& threads) noexcept;
+
+		// calls func(tile, slot) (or just func(tile)) once for every tile in the image.
+		template <typename Func>
+		void run(muu::thread_pool& threads, vec2u image_size, Func&& func)
+		{
+			run_tiles(threads, image_size, nullptr, func);
+		}
+
+		// as above, but stops handing out tiles once the frame is cancelled, and reports progress as tiles complete.
+		template <typename Func>
+		void run(muu::thread_pool& threads, vec2u image_size, render_control& control, Func&& func)
+		{
+			run_tiles(threads, image_size, &control, func);
+		}
+
+		// calls func(pixel) for every pixel in the image, tile by tile.
+		template <typename Func>
+		void for_each_pixel(muu::thread_pool& threads, vec2u image_size, Func&& func)
+		{
+			run(threads, image_size, [&](const tile& t) noexcept { t.for_each_pixel(func); });
+		}
+
+		template <typename Func>
+		void for_each_pixel(muu::thread_pool& threads, vec2u image_size, render_control& control, Func&& func)
+		{
+			run(threads, image_size, control, [&](const tile& t) noexcept { t.for_each_pixel(func); });
+		}
+
+	  private:
+		// per-tile bookkeeping that doesn't depend on the renderer (e.g. publishing the thread's ray count)
+		static void finish_tile() noexcept;
+
+		template <typename Func>
+		void run_tiles(muu::thread_pool& threads, vec2u image_size, render_control* control, Func& func)
+		{
+			resize(image_size);
+			if (tiles_.empty())
+			{
+				if (control)
+					control->progress(1.0f);
+				return;
+			}
+
+			std::atomic_size_t next{};
+			std::atomic_size_t done{};
+			threads.for_range(0u,
+							  slot_count(threads),
+							  [&](unsigned slot) noexcept
+							  {
+								  while (true)
+								  {
+									  if (control && control->stop_requested())
+										  return;
+
+									  const auto i = next.fetch_add(1u, std::memory_order_relaxed);
+									  if (i >= tiles_.size())
+										  return;
+
+									  if constexpr (std::is_invocable_v<Func&, const tile&, unsigned>)
+										  func(tiles_[i], slot);
+									  else
+										  func(tiles_[i]);
+									  finish_tile();
+
+									  if (control)
+									  {
+										  const auto finished = done.fetch_add(1u, std::memory_order_relaxed) + 1u;
+										  control->progress(static_cast<float>(finished)
+															/ static_cast<float>(tiles_.size()));
+									  }
+								  }
+							  });
+			threads.wait();
+
+			if (control && done.load(std::memory_order_relaxed) == tiles_.size())
+				control->progress(1.0f);
+		}
+	};
+}
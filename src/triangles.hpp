@@ -0,0 +1,74 @@
+#pragma once
+#include "common.hpp"
+MUU_DISABLE_WARNINGS;
+#include <soagen.hpp>
+MUU_ENABLE_WARNINGS;
+
+namespace rt
+{
+	namespace detail
+	{
+		template <typename T>
+		using triangle_column = soagen::column_traits<T, soagen::max(std::size_t{ 32u }, alignof(T))>;
+
+		using triangles_traits = soagen::table_traits<triangle_column<unsigned>, // material
+													  triangle_column<float>,	 // v0_x
+													  triangle_column<float>,	 // v0_y
+													  triangle_column<float>,	 // v0_z
+													  triangle_column<float>,	 // e1_x
+													  triangle_column<float>,	 // e1_y
+													  triangle_column<float>,	 // e1_z
+													  triangle_column<float>,	 // e2_x
+													  triangle_column<float>,	 // e2_y
+													  triangle_column<float>>;	 // e2_z
+	}
+
+	// mesh triangles, one row per triangle: the first vertex and the two edges leaving it (what moller-trumbore wants).
+	// this is a plain soagen::table with named columns bolted on rather than a struct generated from soa.toml, so it
+	// can change without regenerating soa.hpp. it works with the same generic helpers as the generated tables
+	// (column<I>(), column_type<I>, column_count, push_back() with every column in order).
+	class triangles : public soagen::table<detail::triangles_traits>
+	{
+	  private:
+		using base = soagen::table<detail::triangles_traits>;
+
+		template <size_t Column>
+		using value = column_type<Column>;
+
+	  public:
+		using base::base;
+
+		template <typename... Args>
+		triangles& push_back(Args&&... args)
+		{
+			base::emplace_back(static_cast<Args&&>(args)...);
+			return *this;
+		}
+
+		// clang-format off
+
+		MUU_PURE_INLINE_GETTER value<0>* material() noexcept { return column<0>(); }
+		MUU_PURE_INLINE_GETTER value<1>* v0_x() noexcept { return column<1>(); }
+		MUU_PURE_INLINE_GETTER value<2>* v0_y() noexcept { return column<2>(); }
+		MUU_PURE_INLINE_GETTER value<3>* v0_z() noexcept { return column<3>(); }
+		MUU_PURE_INLINE_GETTER value<4>* e1_x() noexcept { return column<4>(); }
+		MUU_PURE_INLINE_GETTER value<5>* e1_y() noexcept { return column<5>(); }
+		MUU_PURE_INLINE_GETTER value<6>* e1_z() noexcept { return column<6>(); }
+		MUU_PURE_INLINE_GETTER value<7>* e2_x() noexcept { return column<7>(); }
+		MUU_PURE_INLINE_GETTER value<8>* e2_y() noexcept { return column<8>(); }
+		MUU_PURE_INLINE_GETTER value<9>* e2_z() noexcept { return column<9>(); }
+
+		MUU_PURE_INLINE_GETTER const value<0>* material() const noexcept { return column<0>(); }
+		MUU_PURE_INLINE_GETTER const value<1>* v0_x() const noexcept { return column<1>(); }
+		MUU_PURE_INLINE_GETTER const value<2>* v0_y() const noexcept { return column<2>(); }
+		MUU_PURE_INLINE_GETTER const value<3>* v0_z() const noexcept { return column<3>(); }
+		MUU_PURE_INLINE_GETTER const value<4>* e1_x() const noexcept { return column<4>(); }
+		MUU_PURE_INLINE_GETTER const value<5>* e1_y() const noexcept { return column<5>(); }
+		MUU_PURE_INLINE_GETTER const value<6>* e1_z() const noexcept { return column<6>(); }
+		MUU_PURE_INLINE_GETTER const value<7>* e2_x() const noexcept { return column<7>(); }
+		MUU_PURE_INLINE_GETTER const value<8>* e2_y() const noexcept { return column<8>(); }
+		MUU_PURE_INLINE_GETTER const value<9>* e2_z() const noexcept { return column<9>(); }
+
+		// clang-format on
+	};
+}
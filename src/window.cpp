@@ -51,16 +51,18 @@ namespace
 		std::at_quick_exit([]() { sdl_shutdown(); });
 	}
 
-#ifdef NDEBUG
-	static constexpr float low_res_factor = 0.33f;
-#else
-	static constexpr float low_res_factor = 0.1f;
-#endif
+	// pushed by the render thread to wake the ui loop when a frame is finished
+	MUU_NODISCARD
+	static uint32_t frame_finished_event() noexcept
+	{
+		static const auto type = SDL_RegisterEvents(1);
+		return type;
+	}
 }
 
 static std::array<back_buffer, 2> create_back_buffers(vec2u size, SDL_Renderer* renderer)
 {
-	return { { back_buffer{ size, renderer }, back_buffer{ vec2u{ vec2{ size } * low_res_factor }, renderer } } };
+	return { { back_buffer{ size, renderer }, back_buffer{ size, renderer } } };
 }
 
 window::window(std::string_view title, vec2u size) //
@@ -83,6 +85,8 @@ window::window(std::string_view title, vec2u size) //
 	if (!handles_[1])
 		throw std::runtime_error{ SDL_GetError() };
 
+	// scaled-down interactive frames are stretched over the whole window
+	SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "linear");
 	back_buffers_ = create_back_buffers(size, renderer_handle);
 
 	IMGUI_CHECKVERSION();
@@ -95,14 +99,22 @@ window::window(std::string_view title, vec2u size) //
 window::window(window&& other) noexcept //
 	: handles_{ std::exchange(other.handles_, {}) },
 	  back_buffers_{ std::move(other.back_buffers_) },
-	  low_res{ std::exchange(low_res, {}) }
+	  front_buffer_{ std::exchange(other.front_buffer_, {}) },
+	  front_size_{ std::exchange(other.front_size_, {}) },
+	  interactive{ std::exchange(other.interactive, {}) },
+	  wait_for_events{ other.wait_for_events },
+	  scaling{ other.scaling }
 {}
 
 window& window::operator=(window&& rhs) noexcept
 {
-	handles_	  = std::exchange(rhs.handles_, {});
-	back_buffers_ = std::move(rhs.back_buffers_);
-	low_res		  = std::exchange(rhs.low_res, {});
+	handles_		= std::exchange(rhs.handles_, {});
+	back_buffers_	= std::move(rhs.back_buffers_);
+	front_buffer_	= std::exchange(rhs.front_buffer_, {});
+	front_size_		= std::exchange(rhs.front_size_, {});
+	interactive		= std::exchange(rhs.interactive, {});
+	wait_for_events = rhs.wait_for_events;
+	scaling			= rhs.scaling;
 	return *this;
 }
 
@@ -124,24 +136,70 @@ window::~window() noexcept
 MUU_PURE
 window::operator bool() const noexcept
 {
-	return window_handle   //
-		&& renderer_handle //
-		&& back_buffers_[static_cast<unsigned>(low_res)];
+	return window_handle	//
+		&& renderer_handle	//
+		&& back_buffers_[0] //
+		&& back_buffers_[1];
 }
 
 void window::loop(const window_events& ev)
 {
-	auto prev_time		   = clock::now();
-	auto time_since_resize = clock::now();
-	bool window_resized	   = false;
-	unsigned new_width	   = 0;
-	unsigned new_height	   = 0;
+	// the back buffer is kept locked while the render thread owns it, and handed back when a frame is finished
+	bool back_locked		= false;
+	const auto back			= [&]() noexcept -> back_buffer& { return back_buffers_[front_buffer_ ^ 1u]; };
+	const auto release_back = [&](render_thread& renderer) noexcept
+	{
+		if (!back_locked)
+			return;
+		renderer.cancel();
+		renderer.wait_idle();
+		static_cast<void>(renderer.take_frame());
+		renderer.target({}); // the buffer may be about to be destroyed (e.g. on resize)
+		back().unlock();
+		back_locked = false;
+	};
+
+	render_thread renderer{ []() noexcept
+							{
+								SDL_Event e{};
+								e.type = frame_finished_event();
+								SDL_PushEvent(&e);
+							} };
+	renderer_				 = &renderer;
+	const auto stop_renderer = muu::scope_guard{ [&]() noexcept
+												 {
+													 release_back(renderer);
+													 renderer_ = nullptr;
+												 } };
+
+	auto prev_time			   = clock::now();
+	auto time_since_resize	   = clock::now();
+	bool window_resized		   = false;
+	bool submit_pending		   = false;
+	bool submitted_interactive = false;
+	unsigned new_width		   = 0;
+	unsigned new_height		   = 0;
+	unsigned active_frames	   = 2; // loop iterations left before it's allowed to block
+
+	// when nothing is changing the loop sleeps until there's input or a finished frame. the timeout keeps the
+	// progress bar moving and lets ev.update poll for things that don't raise events (e.g. scene file changes).
+	const auto next_event = [&](SDL_Event& e) noexcept -> bool
+	{
+		if (!wait_for_events || active_frames)
+			return SDL_PollEvent(&e);
+		return SDL_WaitEventTimeout(&e, renderer.busy() ? 100 : 500);
+	};
+
 	while (true)
 	{
 		SDL_Event e;
 		bool backbuffer_dirty = false;
-		while (SDL_PollEvent(&e))
+		active_frames		  = active_frames ? active_frames - 1u : 0u;
+		for (auto have_event = next_event(e); have_event; have_event = SDL_PollEvent(&e))
 		{
+			// imgui sometimes needs a frame or two after an event before it has settled
+			active_frames = 2;
+
 			ImGui_ImplSDL2_ProcessEvent(&e);
 			switch (e.type)
 			{
@@ -197,9 +255,11 @@ void window::loop(const window_events& ev)
 		prev_time = time;
 		if ((to_seconds(time - time_since_resize)) > 0.3 && window_resized)
 		{
+			release_back(renderer);
 			backbuffer_dirty = true;
 			window_resized	 = false;
 			back_buffers_	 = create_back_buffers(vec2u{ new_width, new_height }, renderer_handle);
+			front_size_		 = {};
 		}
 
 		if (ev.update)
@@ -208,23 +268,65 @@ void window::loop(const window_events& ev)
 				return;
 		}
 
-		auto& current_back_buffer = back_buffers_[static_cast<unsigned>(low_res)];
+		// an interactive frame in flight is left to finish rather than being replaced on every camera move,
+		// otherwise a frame that takes longer than the ui loop would never be seen (nor timed).
+		// nothing is submitted until the render thread has been given the current back buffer to draw into.
+		submit_pending = submit_pending || backbuffer_dirty;
+		if (ev.render && submit_pending && back_locked && !(interactive && submitted_interactive && renderer.busy()))
+		{
+			submit_pending		  = false;
+			submitted_interactive = interactive;
+			active_frames		  = 2;
+			if (interactive)
+				renderer.submit(ev.render(scaling.sample_scale()), scaling.apply(back().size()));
+			else
+				renderer.submit(ev.render(1.0f), back().size());
+		}
+
+		// swap in whatever the render thread has finished, then give it the other buffer
+		if (const auto frame = renderer.take_frame(); frame && back_locked)
+		{
+			// only interactive frames are scaled, so they're the only ones that say anything about the budget
+			if (submitted_interactive)
+			{
+				const auto full = vec2{ back().size() };
+				scaling.update(frame->render_time,
+							   static_cast<float>(frame->size.x) * static_cast<float>(frame->size.y) / (full.x * full.y));
+			}
 
-		if (ev.render && current_back_buffer && backbuffer_dirty)
+			back().unlock();
+			back_locked	  = false;
+			front_buffer_ = front_buffer_ ^ 1u;
+			front_size_	  = frame->size;
+			active_frames = 2;
+		}
+		if (!back_locked && back())
 		{
-			ev.render(current_back_buffer.image());
-			current_back_buffer.flush();
+			renderer.target(back().lock());
+			back_locked = true;
 		}
 
+		// keep spinning while something is still in motion
+		if (interactive || submit_pending || window_resized)
+			active_frames = 2;
+
 		ImGui::Render();
 		SDL_RenderClear(renderer_handle);
-		if (current_back_buffer)
-			SDL_RenderCopy(renderer_handle, static_cast<SDL_Texture*>(current_back_buffer.handle()), nullptr, nullptr);
+		if (auto& front = back_buffers_[front_buffer_]; front && front_size_.x && front_size_.y)
+		{
+			const auto src = SDL_Rect{ 0, 0, static_cast<int>(front_size_.x), static_cast<int>(front_size_.y) };
+			SDL_RenderCopy(renderer_handle, static_cast<SDL_Texture*>(front.handle()), &src, nullptr);
+		}
 		ImGui_ImplSDLRenderer2_RenderDrawData(ImGui::GetDrawData());
 		SDL_RenderPresent(renderer_handle);
 	}
 }
 
+float window::render_progress()
+{
+	return renderer_ ? renderer_->progress() : 1.0f;
+}
+
 MUU_PURE
 vec2u window::size() const noexcept
 {
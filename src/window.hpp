@@ -1,6 +1,8 @@
 #pragma once
 #include "common.hpp"
 #include "back_buffer.hpp"
+#include "render_thread.hpp"
+#include "resolution_scaler.hpp"
 MUU_DISABLE_WARNINGS;
 #include <functional>
 #include <array>
@@ -18,21 +20,33 @@ namespace rt
 		std::function<void(int /* virtual key code */)> key_up;
 		std::function<bool(float /* delta_time */, bool& /* backbuffer_dirty */)> update;
 
-		std::function<void(image_view)> render;
+		// called on the ui thread whenever the back buffer is dirty. the returned job is run on the render thread.
+		// interactive frames may ask for fewer samples than the scene specifies (see resolution_scaler).
+		std::function<render_job(float /* sample_scale */)> render;
 	};
 
 	class window
 	{
 	  private:
-		std::array<void*, 2> handles_			 = {};
+		std::array<void*, 2> handles_ = {};
+
+		// the render thread draws into one of these while the other is on screen
 		std::array<back_buffer, 2> back_buffers_ = {};
+		unsigned front_buffer_					 = 0;
+		vec2u front_size_						 = {}; // frames can be smaller than the buffer (see scaling)
+		render_thread* renderer_				 = {}; // only while loop() is running
 
 		MUU_PURE_GETTER
 		static bool get_key(int) noexcept;
 
 	  public:
-		bool low_res	= false;
-		bool mouse_down = false; //
+		// interactive frames are rendered at whatever resolution fits scaling.budget, then upscaled
+		bool interactive = false;
+		bool mouse_down	 = false;
+
+		// block for events instead of redrawing continuously when nothing is changing
+		bool wait_for_events = true;
+		resolution_scaler scaling;
 
 		window() noexcept = default;
 
@@ -51,6 +65,10 @@ namespace rt
 
 		void loop(const window_events& ev);
 
+		// how much of the frame currently being rendered is done
+		MUU_NODISCARD
+		float render_progress();
+
 		MUU_PURE_GETTER
 		vec2u size() const noexcept;
 